@@ -0,0 +1,244 @@
+#include "Bench.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Runs every registered benchmark (or those whose name contains --filter),
+// prints a table, optionally writes the results as JSON and compares them
+// against an earlier JSON run.
+// Usage: 40NetSim-bench [--filter text] [--min-time s] [--json file]
+//                       [--compare baseline.json] [--threshold fraction] [--list]
+
+std::vector<BenchCase>& benchRegistry()
+{
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+BenchRegistrar::BenchRegistrar(const std::string& name, const BenchParams& params, BenchFn fn)
+{
+    // expand the cartesian product of the parameter values
+    std::vector<BenchCase> cases{ BenchCase{ name, {}, fn } };
+    for (const auto& [key, values] : params) {
+        std::vector<BenchCase> next;
+        for (const BenchCase& c : cases) {
+            for (long v : values) {
+                BenchCase e = c;
+                e.name += "/" + key + "=" + std::to_string(v);
+                e.params[key] = v;
+                next.push_back(std::move(e));
+            }
+        }
+        cases.swap(next);
+    }
+    for (auto& c : cases) benchRegistry().push_back(std::move(c));
+}
+
+struct BenchResult
+{
+    std::string                   name;
+    std::uint64_t                 iterations;
+    double                        nsPerOp;
+    std::map<std::string, double> rates; // per wall second
+};
+
+static void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " [--filter text] [--min-time seconds] [--json file]\n"
+              << "          [--compare baseline.json] [--threshold fraction] [--list]\n"
+              << "  --filter     only run benchmarks whose name contains text\n"
+              << "  --min-time   wall time to spend on each benchmark (default 0.5)\n"
+              << "  --json       write the results to file\n"
+              << "  --compare    compare against an earlier --json file; exits 1 on regression\n"
+              << "  --threshold  slowdown counted as a regression (default 0.10 = 10%)\n"
+              << "  --list       print the benchmark names and exit\n";
+}
+
+static std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static bool writeJson(const std::string& path, const std::vector<BenchResult>& results,
+                      double minTime)
+{
+    std::ofstream out(path);
+    if (!out) return false;
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n"
+        << "  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"compiler\": \"" << jsonEscape(__VERSION__) << "\",\n"
+        << "    \"min_time\": " << minTime << "\n"
+        << "  },\n"
+        << "  \"benchmarks\": [\n";
+    out.precision(6);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << "    { \"name\": \"" << jsonEscape(r.name) << "\", "
+            << "\"iterations\": " << r.iterations << ", "
+            << "\"ns_per_op\": " << r.nsPerOp;
+        for (const auto& [rate, value] : r.rates) {
+            out << ", \"" << jsonEscape(rate) << "_per_s\": " << value;
+        }
+        out << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return bool(out);
+}
+
+// Reads name -> ns_per_op back out of a file written by writeJson. Not a
+// general JSON parser: it only relies on each entry carrying "name" before
+// "ns_per_op".
+static bool readBaseline(const std::string& path, std::map<std::string, double>& baseline)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+
+    const std::string nameKey = "\"name\": \"";
+    const std::string nsKey   = "\"ns_per_op\": ";
+    std::size_t pos = 0;
+    while ((pos = text.find(nameKey, pos)) != std::string::npos) {
+        pos += nameKey.size();
+        std::size_t end = text.find('"', pos);
+        std::size_t ns  = text.find(nsKey, pos);
+        if (end == std::string::npos || ns == std::string::npos) break;
+        baseline[text.substr(pos, end - pos)] = std::strtod(text.c_str() + ns + nsKey.size(), nullptr);
+        pos = ns;
+    }
+    return true;
+}
+
+// prints one line per benchmark; returns how many got slower than threshold
+static int compare(const std::vector<BenchResult>& results,
+                   const std::map<std::string, double>& baseline, double threshold)
+{
+    int regressions = 0;
+    std::printf("\n%-56s %12s %12s %8s\n", "benchmark", "base ns", "now ns", "delta");
+    for (const BenchResult& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0.0) {
+            std::printf("%-56s %12s %12.1f %8s  new\n", r.name.c_str(), "-", r.nsPerOp, "");
+            continue;
+        }
+        double delta = r.nsPerOp / it->second - 1.0;
+        const char* verdict = "";
+        if (delta > threshold) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (delta < -threshold) {
+            verdict = "faster";
+        }
+        std::printf("%-56s %12.1f %12.1f %+7.1f%%  %s\n", r.name.c_str(), it->second,
+                    r.nsPerOp, delta * 100.0, verdict);
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string jsonPath;
+    std::string baselinePath;
+    double      minTime   = 0.5;
+    double      threshold = 0.10;
+    bool        list      = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        }
+        if (std::strcmp(arg, "--list") == 0) {
+            list = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(arg, "--filter") == 0) {
+            filter = value;
+        } else if (std::strcmp(arg, "--min-time") == 0) {
+            minTime = std::atof(value);
+        } else if (std::strcmp(arg, "--json") == 0) {
+            jsonPath = value;
+        } else if (std::strcmp(arg, "--compare") == 0) {
+            baselinePath = value;
+        } else if (std::strcmp(arg, "--threshold") == 0) {
+            threshold = std::atof(value);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (minTime <= 0.0 || threshold < 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline)) {
+        std::cerr << "cannot read baseline " << baselinePath << "\n";
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    for (const BenchCase& c : benchRegistry()) {
+        if (!filter.empty() && c.name.find(filter) == std::string::npos) continue;
+        if (list) {
+            std::cout << c.name << "\n";
+            continue;
+        }
+
+        BenchState state(c.params, minTime);
+        c.fn(state);
+
+        BenchResult r{ c.name, state.iterations(), 0.0, {} };
+        if (state.iterations() > 0 && state.seconds() > 0.0) {
+            r.nsPerOp = state.seconds() * 1e9 / static_cast<double>(state.iterations());
+            for (const auto& [rate, perIter] : state.rates()) {
+                r.rates[rate] = perIter * static_cast<double>(state.iterations()) / state.seconds();
+            }
+        }
+
+        std::printf("%-56s %12.1f ns %10llu it", r.name.c_str(), r.nsPerOp,
+                    static_cast<unsigned long long>(r.iterations));
+        for (const auto& [rate, value] : r.rates) std::printf("  %.4g %s/s", value, rate.c_str());
+        std::printf("\n");
+        std::fflush(stdout);
+        results.push_back(std::move(r));
+    }
+    if (list) return 0;
+
+    if (!jsonPath.empty() && !writeJson(jsonPath, results, minTime)) {
+        std::cerr << "cannot write " << jsonPath << "\n";
+        return 1;
+    }
+    if (!baselinePath.empty()) {
+        int regressions = compare(results, baseline, threshold);
+        if (regressions > 0) {
+            std::printf("\n%d regression(s) beyond %.0f%%\n", regressions, threshold * 100.0);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A small self-contained benchmark harness. A benchmark is a function that
+// does its setup and then loops on `while (state.keepRunning()) { ... }`;
+// the harness keeps it looping until --min-time has passed and reports the
+// wall time per iteration. Benchmarks register themselves at static-init
+// time, so a bench binary is just the objects it links:
+//
+//   static BenchRegistrar reg("network/getDevice", { { "nodes", { 1000, 100000 } } },
+//                             [](BenchState& state) { ... });
+//
+// Every combination of the parameter values becomes its own case, named
+// e.g. "network/getDevice/nodes=1000".
+
+using BenchParams = std::vector<std::pair<std::string, std::vector<long>>>;
+
+class BenchState
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    BenchState(std::map<std::string, long> params, double minTime)
+        : params_(std::move(params)), minTime_(minTime) {}
+
+    long param(const std::string& name) const { return params_.at(name); }
+
+    // true while the body should run once more; checks the clock only on
+    // power-of-two iteration counts so cheap bodies are not drowned out
+    bool keepRunning()
+    {
+        if (done_ < budget_) {
+            ++done_;
+            return true;
+        }
+        return refill();
+    }
+
+    // exclude setup done inside the loop (refilling, draining) from the timing
+    void pauseTiming()  { pausedAt_ = Clock::now(); }
+    void resumeTiming() { paused_ += Clock::now() - pausedAt_; }
+
+    // something the body does `perIteration` times per pass, reported as a
+    // rate per wall second ("packets", "sim_seconds", ...)
+    void setRate(const std::string& name, double perIteration) { rates_[name] = perIteration; }
+
+    std::uint64_t iterations() const { return done_; }
+    double        seconds()    const { return elapsed_; }
+    const std::map<std::string, double>& rates() const { return rates_; }
+
+private:
+    bool refill()
+    {
+        Clock::time_point now = Clock::now();
+        if (!started_) {
+            started_ = true;
+            start_   = now;
+            budget_  = done_ = 1;
+            return true;
+        }
+        elapsed_ = std::chrono::duration<double>(now - start_ - paused_).count();
+        if (elapsed_ >= minTime_) return false;
+        budget_ *= 2;
+        ++done_;
+        return true;
+    }
+
+    std::map<std::string, long>   params_;
+    std::map<std::string, double> rates_;
+    double                        minTime_;
+    double                        elapsed_ = 0.0;
+
+    bool              started_ = false;
+    std::uint64_t     done_    = 0;
+    std::uint64_t     budget_  = 0;
+    Clock::time_point start_;
+    Clock::time_point pausedAt_;
+    Clock::duration   paused_{};
+};
+
+using BenchFn = std::function<void(BenchState&)>;
+
+struct BenchCase
+{
+    std::string                 name; // base name plus "/param=value" parts
+    std::map<std::string, long> params;
+    BenchFn                     fn;
+};
+
+// every registered case, in registration order
+std::vector<BenchCase>& benchRegistry();
+
+struct BenchRegistrar
+{
+    BenchRegistrar(const std::string& name, const BenchParams& params, BenchFn fn);
+};
+
+// keep the optimiser from discarding a value the benchmark computed
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
@@ -0,0 +1,51 @@
+#include "Bench.hpp"
+#include "gui/Renderer.hpp"
+#include <memory>
+#include <random>
+
+// Renderer::draw into an offscreen texture. Only linked into the SFML build
+// of the bench binary (make bench-gui).
+
+namespace {
+
+class IdleDevice : public Device
+{
+public:
+    IdleDevice(int id) : Device(id, NetworkScope::Local) {}
+    DeviceInfo info() const override { return DeviceInfo{ "idle", "", "", "", "", "" }; }
+    void onPacketReceived(const Packet&) override {}
+};
+
+BenchRegistrar drawBench("render/draw",
+    { { "nodes", { 100, 2000 } }, { "inflight", { 1000, 50000 } } },
+    [](BenchState& state) {
+        sf::RenderTexture target;
+        if (!target.create(1280, 720)) return; // no GL context: nothing to measure
+
+        Network net;
+        const long nodes = state.param("nodes");
+        for (int i = 0; i < nodes; ++i) net.addDevice(std::make_unique<IdleDevice>(i));
+        std::mt19937 rng(42);
+        for (int i = 0; i < nodes; ++i) {
+            net.addLink(i, static_cast<int>(rng() % nodes), 1000.0, 1e9); // packets never land
+        }
+        const auto& links = net.links();
+        for (long i = 0; i < state.param("inflight"); ++i) {
+            const Link& l = links[static_cast<std::size_t>(i) % links.size()];
+            Packet pkt{};
+            pkt.id        = static_cast<std::uint64_t>(i);
+            pkt.sizeBytes = 1500;
+            pkt.dstPort   = (i % 3 == 0) ? 443 : (i % 3 == 1) ? 53 : 8080;
+            net.spawnPacketOnLink(pkt, l.nodeA, l.nodeB);
+        }
+
+        Renderer renderer(target, net);
+        while (state.keepRunning()) {
+            target.clear();
+            renderer.draw();
+            target.display();
+        }
+        state.setRate("frames", 1.0);
+    });
+
+} // namespace
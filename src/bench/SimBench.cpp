@@ -0,0 +1,280 @@
+#include "Bench.hpp"
+#include "sim/HomeScenario.hpp"
+#include "sim/Network.hpp"
+#include "sim/PcapWriter.hpp"
+#include "sim/Simulation.hpp"
+#include "sim/TrafficGenerator.hpp"
+#include <memory>
+#include <random>
+
+// Benchmarks for the simulation core: the Network hot paths in isolation,
+// Simulation::step under a steady load, traffic generation at scale,
+// capture export, and the demo scenario end to end.
+
+namespace {
+
+// does nothing with what it receives
+class SinkDevice : public Device
+{
+public:
+    SinkDevice(int id) : Device(id, NetworkScope::Local) {}
+    DeviceInfo info() const override { return DeviceInfo{ "sink", "", "", "", "", "" }; }
+    void onPacketReceived(const Packet&) override {}
+};
+
+// sends every packet straight back where it came from, so a seeded load
+// stays on the wire indefinitely
+class EchoDevice : public Device
+{
+public:
+    EchoDevice(int id, Network& net) : Device(id, NetworkScope::Local), net_(net) {}
+    DeviceInfo info() const override { return DeviceInfo{ "echo", "", "", "", "", "" }; }
+    void onPacketReceived(const Packet& pkt) override
+    {
+        Packet back = pkt;
+        back.srcNodeId = id_;
+        back.dstNodeId = pkt.srcNodeId;
+        net_.spawnPacketOnLink(back, id_, pkt.srcNodeId);
+    }
+
+private:
+    Network& net_;
+};
+
+struct Endpoints
+{
+    int from;
+    int to;
+};
+
+// a ring (so everything is connected) plus random chords up to
+// nodes * degree / 2 links; returns the endpoints of every link
+template <typename MakeDevice>
+std::vector<Endpoints> buildMesh(Network& net, long nodes, long degree, double latencyMs,
+                                 MakeDevice makeDevice)
+{
+    std::mt19937 rng(42);
+    for (int i = 0; i < nodes; ++i) net.addDevice(makeDevice(i));
+
+    std::vector<Endpoints> ends;
+    const long links = std::max(nodes, nodes * degree / 2);
+    std::uniform_int_distribution<int> pick(0, static_cast<int>(nodes) - 1);
+    for (long l = 0; l < links; ++l) {
+        int a = static_cast<int>(l % nodes);
+        int b = l < nodes ? static_cast<int>((l + 1) % nodes) : pick(rng);
+        if (a == b) b = (b + 1) % static_cast<int>(nodes);
+        net.addLink(a, b, 1000.0, latencyMs);
+        ends.push_back({ a, b });
+    }
+    return ends;
+}
+
+std::unique_ptr<Device> makeSink(int id) { return std::make_unique<SinkDevice>(id); }
+
+Packet benchPacket(std::uint64_t id, int from, int to)
+{
+    Packet pkt{};
+    pkt.id        = id;
+    pkt.srcNodeId = from;
+    pkt.dstNodeId = to;
+    pkt.sizeBytes = 1500;
+    return pkt;
+}
+
+constexpr std::size_t kSampleMask = 4095; // lookups cycle through 4096 random keys
+
+BenchRegistrar spawnBench("network/spawnPacketOnLink",
+    { { "nodes", { 100, 10000 } }, { "degree", { 2, 8 } } },
+    [](BenchState& state) {
+        Network net;
+        std::vector<Endpoints> ends = buildMesh(net, state.param("nodes"), state.param("degree"),
+                                                1.0, makeSink);
+        std::mt19937 rng(7);
+        std::vector<Endpoints> sample(kSampleMask + 1);
+        for (auto& e : sample) e = ends[rng() % ends.size()];
+
+        std::uint64_t i = 0;
+        while (state.keepRunning()) {
+            const Endpoints& e = sample[i & kSampleMask];
+            net.spawnPacketOnLink(benchPacket(i, e.from, e.to), e.from, e.to);
+            if ((++i & 0xffff) == 0) {
+                // land everything so the in-flight table stays bounded
+                state.pauseTiming();
+                net.updatePackets(1000.0);
+                state.resumeTiming();
+            }
+        }
+        state.setRate("packets", 1.0);
+    });
+
+BenchRegistrar updateBench("network/updatePackets",
+    { { "inflight", { 1000, 100000, 1000000 } } },
+    [](BenchState& state) {
+        Network net;
+        // latency far beyond the run, so nothing lands and the load stays fixed
+        std::vector<Endpoints> ends = buildMesh(net, 1000, 4, 1e9, makeSink);
+        const long inflight = state.param("inflight");
+        for (long i = 0; i < inflight; ++i) {
+            const Endpoints& e = ends[static_cast<std::size_t>(i) % ends.size()];
+            net.spawnPacketOnLink(benchPacket(i, e.from, e.to), e.from, e.to);
+        }
+
+        while (state.keepRunning()) {
+            net.updatePackets(0.001);
+        }
+        state.setRate("packets", static_cast<double>(inflight));
+    });
+
+BenchRegistrar getDeviceBench("network/getDevice",
+    { { "nodes", { 1000, 100000 } } },
+    [](BenchState& state) {
+        Network net;
+        const long nodes = state.param("nodes");
+        for (int i = 0; i < nodes; ++i) net.addDevice(makeSink(i));
+        std::mt19937 rng(7);
+        std::vector<int> sample(kSampleMask + 1);
+        for (int& id : sample) id = static_cast<int>(rng() % nodes);
+
+        std::size_t i = 0;
+        while (state.keepRunning()) {
+            doNotOptimize(net.getDevice(sample[i++ & kSampleMask]));
+        }
+        state.setRate("lookups", 1.0);
+    });
+
+BenchRegistrar findLinkBench("network/findLink",
+    { { "nodes", { 1000, 100000 } }, { "degree", { 2, 8 } } },
+    [](BenchState& state) {
+        Network net;
+        std::vector<Endpoints> ends = buildMesh(net, state.param("nodes"), state.param("degree"),
+                                                1.0, makeSink);
+        std::mt19937 rng(7);
+        std::vector<Endpoints> sample(kSampleMask + 1);
+        for (auto& e : sample) e = ends[rng() % ends.size()];
+
+        std::size_t i = 0;
+        while (state.keepRunning()) {
+            const Endpoints& e = sample[i++ & kSampleMask];
+            doNotOptimize(net.findLink(e.from, e.to));
+        }
+        state.setRate("lookups", 1.0);
+    });
+
+BenchRegistrar stepBench("simulation/step",
+    { { "nodes", { 100, 10000 } }, { "inflight", { 1000, 100000 } } },
+    [](BenchState& state) {
+        Network net;
+        Simulation sim(net);
+        std::vector<Endpoints> ends = buildMesh(net, state.param("nodes"), 4, 5.0,
+            [&net](int id) { return std::make_unique<EchoDevice>(id, net); });
+        const long inflight = state.param("inflight");
+        for (long i = 0; i < inflight; ++i) {
+            const Endpoints& e = ends[static_cast<std::size_t>(i) % ends.size()];
+            net.spawnPacketOnLink(benchPacket(i, e.from, e.to), e.from, e.to);
+        }
+
+        const double dt = 0.001;
+        while (state.keepRunning()) {
+            sim.step(dt);
+        }
+        state.setRate("sim_seconds", dt);
+    });
+
+// devices that never ask to wake: the step should not scale with them
+BenchRegistrar idleStepBench("simulation/step-idle-devices",
+    { { "nodes", { 1000, 100000 } } },
+    [](BenchState& state) {
+        Network net;
+        Simulation sim(net);
+        const long nodes = state.param("nodes");
+        for (int i = 0; i < nodes; ++i) net.addDevice(makeSink(i));
+
+        const double dt = 0.001;
+        while (state.keepRunning()) {
+            sim.step(dt);
+        }
+        state.setRate("sim_seconds", dt);
+    });
+
+BenchRegistrar scenarioBench("scenario/home",
+    { { "homes", { 1, 16 } } },
+    [](BenchState& state) {
+        Network net;
+        Simulation sim(net);
+        std::vector<std::unique_ptr<HomeScenario>> homes;
+        int nextId = 0;
+        for (long h = 0; h < state.param("homes"); ++h) {
+            homes.push_back(std::make_unique<HomeScenario>(net, sim, 1 + static_cast<std::uint32_t>(h), nextId));
+            homes.back()->build();
+            homes.back()->start();
+            nextId = homes.back()->nextFreeId();
+        }
+
+        const double slice = 60.0;
+        while (state.keepRunning()) {
+            sim.run(sim.time() + slice, 0.01);
+        }
+        state.setRate("sim_seconds", slice);
+    });
+
+BenchRegistrar trafficBench("traffic/poisson",
+    { { "clients", { 1000, 100000 } } },
+    [](BenchState& state) {
+        Network net;
+        Simulation sim(net);
+        const long clients = state.param("clients");
+        buildMesh(net, clients, 2, 1.0, makeSink);
+
+        // every client sends about once every 10 s
+        TrafficProfile prof;
+        prof.name      = "bench";
+        prof.arrival   = TrafficProfile::Arrival::Poisson;
+        prof.rate      = 0.1;
+        prof.perClient = true;
+        prof.size      = TrafficProfile::Size::Exponential;
+        prof.sizeA     = 500.0;
+        std::uint64_t nextId = 1;
+        TrafficGenerator gen(net, sim, 1, nextId);
+        gen.addProfile(prof);
+        std::vector<int> ids(static_cast<std::size_t>(clients));
+        for (long i = 0; i < clients; ++i) ids[i] = static_cast<int>(i);
+        gen.start(ids);
+
+        const double slice = 0.1;
+        while (state.keepRunning()) {
+            sim.run(sim.time() + slice, 0.01);
+        }
+        state.setRate("arrivals", prof.rate * static_cast<double>(clients) * slice);
+    });
+
+// frames synthesised and handed to the I/O thread; the file is /dev/null
+// so this measures the producer side and buffer recycling, not the disk
+BenchRegistrar pcapBench("pcap/write",
+    { { "ng", { 0, 1 } } },
+    [](BenchState& state) {
+        PcapWriter writer;
+        std::string error;
+        writer.open("/dev/null", state.param("ng") ? CaptureFormat::PcapNg : CaptureFormat::Pcap, error);
+        const std::uint32_t iface = writer.addInterface("bench");
+        const std::uint8_t src[6] = { 2, 0, 0, 0, 0, 1 }, dst[6] = { 2, 0, 0, 0, 0, 2 };
+
+        Packet p{};
+        p.sizeBytes = 900;
+        p.srcIp     = makeIpv4(192, 168, 0, 10);
+        p.dstIp     = makeIpv4(192, 168, 0, 1);
+        p.srcPort   = 50000;
+        p.dstPort   = 443;
+        const int batch = 10000;
+        double t = 0.0;
+        while (state.keepRunning()) {
+            for (int i = 0; i < batch; ++i) {
+                p.id = static_cast<std::uint64_t>(i);
+                p.transport = (i & 3) == 0 ? TransportProtocol::UDP : TransportProtocol::TCP;
+                writer.write(p, t, iface, src, dst);
+                t += 1e-6;
+            }
+        }
+        state.setRate("packets", batch);
+    });
+
+} // namespace
@@ -0,0 +1,254 @@
+#include "ForceLayout.hpp"
+#include <algorithm>
+#include <cmath>
+
+static constexpr float kTheta      = 0.9f;  // Barnes-Hut opening angle
+static constexpr float kCooling    = 0.96f; // temperature factor per iteration
+static constexpr float kMinTemp    = 0.25f; // px; below this the layout is done
+static constexpr int   kMaxDepth   = 24;    // coincident nodes share a leaf past this
+
+ForceLayout::ForceLayout()
+    : worker_(&ForceLayout::run, this)
+{
+}
+
+ForceLayout::~ForceLayout()
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        quit_ = true;
+    }
+    cv_.notify_one();
+    worker_.join();
+}
+
+void ForceLayout::start(std::vector<sf::Vector2f> initial,
+                        std::vector<std::pair<int, int>> edges,
+                        const sf::FloatRect& area)
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        pending_.pos   = std::move(initial);
+        pending_.edges = std::move(edges);
+        pending_.area  = area;
+        hasJob_    = true;
+        converged_ = false;
+        ++jobGen_;
+    }
+    cv_.notify_one();
+}
+
+bool ForceLayout::poll(std::vector<sf::Vector2f>& positions)
+{
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!fresh_) return false;
+    positions.swap(published_);
+    fresh_ = false;
+    return true;
+}
+
+bool ForceLayout::converged() const
+{
+    std::lock_guard<std::mutex> lk(mu_);
+    return converged_;
+}
+
+void ForceLayout::publish(const std::vector<sf::Vector2f>& pos, std::uint64_t gen)
+{
+    std::lock_guard<std::mutex> lk(mu_);
+    if (gen != jobGen_) return;
+    published_.assign(pos.begin(), pos.end());
+    fresh_ = true;
+}
+
+void ForceLayout::run()
+{
+    Job job;
+    std::uint64_t gen = 0;
+    float temperature = 0.f;
+    bool  active = false;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            if (!active) cv_.wait(lk, [this] { return quit_ || hasJob_; });
+            if (quit_) return;
+            if (hasJob_) {
+                // a newer graph replaces the one in progress
+                job = std::move(pending_);
+                gen = jobGen_;
+                hasJob_ = false;
+                active  = true;
+                temperature = std::max(job.area.width, job.area.height) / 10.f;
+            }
+        }
+
+        active = iterate(job, temperature);
+        publish(job.pos, gen);
+        if (!active) {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (!hasJob_) converged_ = true;
+        }
+    }
+}
+
+bool ForceLayout::iterate(Job& job, float& temperature)
+{
+    std::vector<sf::Vector2f>& pos = job.pos;
+    const std::size_t n = pos.size();
+    if (n == 0) return false;
+
+    const float area = std::max(job.area.width * job.area.height, 1.f);
+    const float k    = std::sqrt(area / static_cast<float>(n)); // ideal edge length
+    const float k2   = k * k;
+    const sf::Vector2f center(job.area.left + job.area.width / 2.f,
+                              job.area.top + job.area.height / 2.f);
+    // gravity that balances the whole graph's repulsion at the area's edge,
+    // so disconnected pieces stay on screen
+    const float radius  = std::sqrt(area) / 2.f;
+    const float gravity = k2 * static_cast<float>(n) / (radius * radius) / radius;
+
+    buildTree(pos);
+    disp_.assign(n, sf::Vector2f(0.f, 0.f));
+    for (std::size_t i = 0; i < n; ++i) {
+        disp_[i] = repulsion(static_cast<int>(i), pos, k2);
+        sf::Vector2f toCenter = center - pos[i];
+        disp_[i] += gravity * std::sqrt(toCenter.x * toCenter.x + toCenter.y * toCenter.y) * toCenter;
+    }
+    for (const auto& [a, b] : job.edges) {
+        if (a == b) continue;
+        sf::Vector2f d = pos[a] - pos[b];
+        float dist = std::sqrt(d.x * d.x + d.y * d.y);
+        if (dist < 1e-3f) continue;
+        sf::Vector2f f = (dist / k) * d; // |f| = dist^2 / k
+        disp_[a] -= f;
+        disp_[b] += f;
+    }
+
+    // move each node along its force, at most `temperature` pixels
+    for (std::size_t i = 0; i < n; ++i) {
+        float len = std::sqrt(disp_[i].x * disp_[i].x + disp_[i].y * disp_[i].y);
+        if (len > 1e-6f) pos[i] += (std::min(len, temperature) / len) * disp_[i];
+    }
+
+    temperature *= kCooling;
+    return temperature > kMinTemp;
+}
+
+void ForceLayout::buildTree(const std::vector<sf::Vector2f>& pos)
+{
+    float x0 = pos[0].x, x1 = x0, y0 = pos[0].y, y1 = y0;
+    for (const auto& p : pos) {
+        x0 = std::min(x0, p.x);
+        x1 = std::max(x1, p.x);
+        y0 = std::min(y0, p.y);
+        y1 = std::max(y1, p.y);
+    }
+    cells_.clear();
+    cells_.reserve(pos.size() * 2);
+    Cell root;
+    root.cx   = (x0 + x1) / 2.f;
+    root.cy   = (y0 + y1) / 2.f;
+    root.half = std::max(x1 - x0, y1 - y0) / 2.f + 1.f;
+    cells_.push_back(root);
+
+    for (std::size_t i = 0; i < pos.size(); ++i) insert(0, static_cast<int>(i), pos, 0);
+}
+
+void ForceLayout::insert(int cell, int body, const std::vector<sf::Vector2f>& pos, int depth)
+{
+    for (;;) {
+        Cell& c = cells_[cell];
+        const sf::Vector2f p = pos[body];
+        c.mass += 1.f;
+        c.mx   += p.x;
+        c.my   += p.y;
+
+        const bool leaf = c.child[0] == -1 && c.child[1] == -1 &&
+                          c.child[2] == -1 && c.child[3] == -1;
+        if (leaf && c.body == -1 && c.mass == 1.f) {
+            c.body = body; // empty leaf takes the body
+            return;
+        }
+        if (depth >= kMaxDepth) return; // too close to tell apart; lump them
+
+        if (leaf && c.body != -1) {
+            // split: push the resident body one level down
+            int resident = c.body;
+            c.body = -1;
+            const sf::Vector2f rp = pos[resident];
+            int q = (rp.x >= c.cx ? 1 : 0) | (rp.y >= c.cy ? 2 : 0);
+            Cell sub;
+            sub.half = c.half / 2.f;
+            sub.cx   = c.cx + ((q & 1) ? sub.half : -sub.half);
+            sub.cy   = c.cy + ((q & 2) ? sub.half : -sub.half);
+            sub.mass = 1.f;
+            sub.mx   = rp.x;
+            sub.my   = rp.y;
+            sub.body = resident;
+            int idx = static_cast<int>(cells_.size());
+            cells_.push_back(sub); // may reallocate: c is stale from here
+            cells_[cell].child[q] = idx;
+        }
+
+        Cell& cur = cells_[cell];
+        int q = (p.x >= cur.cx ? 1 : 0) | (p.y >= cur.cy ? 2 : 0);
+        if (cur.child[q] == -1) {
+            Cell sub;
+            sub.half = cur.half / 2.f;
+            sub.cx   = cur.cx + ((q & 1) ? sub.half : -sub.half);
+            sub.cy   = cur.cy + ((q & 2) ? sub.half : -sub.half);
+            sub.mass = 1.f;
+            sub.mx   = p.x;
+            sub.my   = p.y;
+            sub.body = body;
+            int idx = static_cast<int>(cells_.size());
+            cells_.push_back(sub);
+            cells_[cell].child[q] = idx;
+            return;
+        }
+        cell = cur.child[q];
+        ++depth;
+    }
+}
+
+sf::Vector2f ForceLayout::repulsion(int body, const std::vector<sf::Vector2f>& pos, float k2) const
+{
+    const sf::Vector2f p = pos[body];
+    sf::Vector2f f(0.f, 0.f);
+
+    stack_.clear();
+    stack_.push_back(0);
+    while (!stack_.empty()) {
+        const Cell& c = cells_[stack_.back()];
+        stack_.pop_back();
+        if (c.mass == 0.f || c.body == body) continue;
+
+        float cmx = c.mx / c.mass;
+        float cmy = c.my / c.mass;
+        float dx = p.x - cmx;
+        float dy = p.y - cmy;
+        float d2 = dx * dx + dy * dy;
+
+        const bool leaf = c.child[0] == -1 && c.child[1] == -1 &&
+                          c.child[2] == -1 && c.child[3] == -1;
+        // far enough away (size / distance < theta) to treat as one mass
+        if (leaf || 4.f * c.half * c.half < kTheta * kTheta * d2) {
+            if (d2 < 1e-4f) {
+                // coincident: nudge apart deterministically
+                dx = static_cast<float>((body * 7919) % 17) - 8.f;
+                dy = static_cast<float>((body * 104729) % 13) - 6.f;
+                d2 = dx * dx + dy * dy + 1e-4f;
+            }
+            // |f| = k^2 * mass / d
+            float s = k2 * c.mass / d2;
+            f.x += dx * s;
+            f.y += dy * s;
+            continue;
+        }
+        for (int q = 0; q < 4; ++q) {
+            if (c.child[q] != -1) stack_.push_back(c.child[q]);
+        }
+    }
+    return f;
+}
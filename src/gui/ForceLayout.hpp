@@ -0,0 +1,82 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fruchterman-Reingold force-directed layout on a worker thread. Node
+// repulsion uses a Barnes-Hut quadtree, so an iteration costs O(n log n)
+// plus O(links). Each iteration's positions are published through a double
+// buffer: the worker fills one side and swaps it in under a short lock,
+// and the UI swaps it out with poll(), so neither side waits on the other.
+class ForceLayout
+{
+public:
+    ForceLayout();
+    ~ForceLayout();
+
+    ForceLayout(const ForceLayout&) = delete;
+    ForceLayout& operator=(const ForceLayout&) = delete;
+
+    // Lay out nodes 0..initial.size()-1 joined by `edges`, starting from
+    // `initial`, inside `area`. Replaces whatever job was running.
+    void start(std::vector<sf::Vector2f> initial,
+               std::vector<std::pair<int, int>> edges,
+               const sf::FloatRect& area);
+
+    // If positions were published since the last call, swap them into
+    // `positions` and return true. `positions` must not be touched by
+    // anyone else between calls, since it becomes the next back buffer.
+    bool poll(std::vector<sf::Vector2f>& positions);
+
+    // the current job has cooled down and stopped moving
+    bool converged() const;
+
+private:
+    struct Job
+    {
+        std::vector<sf::Vector2f>        pos;
+        std::vector<std::pair<int, int>> edges;
+        sf::FloatRect                    area;
+    };
+
+    void run();
+    // one cooling step; returns false once the temperature is spent
+    bool iterate(Job& job, float& temperature);
+    // dropped if a newer job has been started since `gen` was picked up
+    void publish(const std::vector<sf::Vector2f>& pos, std::uint64_t gen);
+
+    // Barnes-Hut quadtree, rebuilt every iteration
+    struct Cell
+    {
+        float cx, cy, half;     // square this cell covers
+        float mass = 0.f;
+        float mx = 0.f, my = 0.f; // mass-weighted position sum
+        int   child[4] = { -1, -1, -1, -1 };
+        int   body = -1;        // the single body of a leaf, -1 otherwise
+    };
+    void buildTree(const std::vector<sf::Vector2f>& pos);
+    void insert(int cell, int body, const std::vector<sf::Vector2f>& pos, int depth);
+    sf::Vector2f repulsion(int body, const std::vector<sf::Vector2f>& pos, float k2) const;
+
+    std::vector<Cell>         cells_;
+    std::vector<sf::Vector2f> disp_;
+    mutable std::vector<int>  stack_;
+
+    mutable std::mutex      mu_;
+    std::condition_variable cv_;
+    Job                     pending_;
+    bool                    hasJob_    = false;
+    std::uint64_t           jobGen_    = 0;
+    bool                    quit_      = false;
+    bool                    converged_ = true;
+
+    // the published side of the double buffer
+    std::vector<sf::Vector2f> published_;
+    bool                      fresh_ = false;
+
+    std::thread worker_; // last, so it starts after everything it touches
+};
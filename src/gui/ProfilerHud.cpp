@@ -0,0 +1,68 @@
+#include "ProfilerHud.hpp"
+#include <algorithm>
+#include <cstdio>
+
+void ProfilerHud::update(const ProfileFrame& frame)
+{
+    // exponential moving average so the numbers are readable at 60 fps
+    const double a = 0.1;
+    wallMs_ += a * (frame.wallMs - wallMs_);
+    for (std::size_t i = 0; i < kPhaseCount; ++i) {
+        phaseMs_[i] += a * (frame.phaseNs[i] / 1e6 - phaseMs_[i]);
+    }
+    counts_ = frame.counts;
+}
+
+void ProfilerHud::draw(sf::RenderTarget& target) const
+{
+    if (!visible_) return;
+
+    const float lineH  = 16.f;
+    const float width  = 300.f;
+    const float height = lineH * (2 + kPhaseCount + kCounterCount) + 12.f;
+    const float x      = target.getSize().x - width - 10.f;
+    const float y      = 10.f;
+
+    sf::RectangleShape panel({ width, height });
+    panel.setPosition(x, y);
+    panel.setFillColor(sf::Color(0, 0, 0, 190));
+    panel.setOutlineThickness(1.f);
+    panel.setOutlineColor(sf::Color(120, 120, 120));
+    target.draw(panel);
+
+    char buf[96];
+    float ly = y + 6.f;
+    auto line = [&](const char* s, sf::Color color) {
+        sf::Text t;
+        t.setFont(font_);
+        t.setCharacterSize(12);
+        t.setFillColor(color);
+        t.setString(s);
+        t.setPosition(x + 8.f, ly);
+        target.draw(t);
+        ly += lineH;
+    };
+
+    std::snprintf(buf, sizeof buf, "frame %.2f ms (%.0f fps)", wallMs_,
+                  wallMs_ > 0.0 ? 1000.0 / wallMs_ : 0.0);
+    line(buf, sf::Color::White);
+
+    for (std::size_t i = 0; i < kPhaseCount; ++i) {
+        // bar behind the text, as a share of the frame
+        float share = wallMs_ > 0.0 ? static_cast<float>(std::min(1.0, phaseMs_[i] / wallMs_)) : 0.f;
+        sf::RectangleShape bar({ (width - 16.f) * share, lineH - 3.f });
+        bar.setPosition(x + 8.f, ly + 2.f);
+        bar.setFillColor(sf::Color(70, 110, 180, 160));
+        target.draw(bar);
+
+        std::snprintf(buf, sizeof buf, "%-12s %8.3f ms", phaseName(static_cast<Phase>(i)), phaseMs_[i]);
+        line(buf, sf::Color(220, 220, 220));
+    }
+
+    line("per frame", sf::Color(160, 160, 160));
+    for (std::size_t i = 0; i < kCounterCount; ++i) {
+        std::snprintf(buf, sizeof buf, "%-12s %8llu", counterName(static_cast<Counter>(i)),
+                      static_cast<unsigned long long>(counts_[i]));
+        line(buf, sf::Color(220, 220, 220));
+    }
+}
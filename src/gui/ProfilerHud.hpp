@@ -0,0 +1,26 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "../sim/Profiler.hpp"
+#include <array>
+
+// Overlay listing the profiler's phase times (smoothed over recent frames,
+// with a bar against the frame time) and last frame's counters.
+class ProfilerHud
+{
+public:
+    explicit ProfilerHud(const sf::Font& font) : font_(font) {}
+
+    void toggle() { visible_ = !visible_; }
+    bool visible() const { return visible_; }
+
+    void update(const ProfileFrame& frame);
+    void draw(sf::RenderTarget& target) const;
+
+private:
+    const sf::Font& font_;
+    bool            visible_ = false;
+
+    double                                   wallMs_ = 0.0;
+    std::array<double, kPhaseCount>          phaseMs_{};
+    std::array<std::uint64_t, kCounterCount> counts_{};
+};
@@ -1,29 +1,35 @@
 #include "Renderer.hpp"
+#include "../sim/Profiler.hpp"
 #include <cmath>
 #include <algorithm>
 
-Renderer::Renderer(sf::RenderWindow& window, Network& network)
-    : window_(window), network_(network) 
+Renderer::Renderer(sf::RenderTarget& target, Network& network)
+    : target_(target), network_(network),
+      useBuffers_(sf::VertexBuffer::isAvailable()),
+      view_(target.getDefaultView())
 {
+    network_.setPacketBinning(true);
+    buildPacketSprite();
     updateLayout();
 }
 
 const NodeVisual* Renderer::findNodeVisual(int deviceId) const
 {
-    for (const auto& v : visuals_) {
-        if (v.deviceId == deviceId) return &v;
-    }
-    return nullptr;
+    if (deviceId < 0 || static_cast<std::size_t>(deviceId) >= visualSlot_.size()) return nullptr;
+    int slot = visualSlot_[deviceId];
+    return slot == -1 ? nullptr : &visuals_[slot];
 }
 
 void Renderer::updateLayout() 
 {
+    layoutDirty_ = true;
     visuals_.clear();
+    visualSlot_.clear();
 
     const float radius = 220.0f;
     const sf::Vector2f center(
-        window_.getSize().x / 2.f,
-        window_.getSize().y / 2.f
+        target_.getSize().x / 2.f,
+        target_.getSize().y / 2.f
     );
 
     const auto& devices = network_.devices();
@@ -39,90 +45,492 @@ void Renderer::updateLayout()
             center.y + radius * std::sin(angle)
         };
 
-        visuals_.push_back(NodeVisual{ devices[i]->id(), pos });
+        int id = devices[i]->id();
+        if (static_cast<std::size_t>(id) >= visualSlot_.size()) visualSlot_.resize(id + 1, -1);
+        visualSlot_[id] = static_cast<int>(visuals_.size());
+        visuals_.push_back(NodeVisual{ id, pos });
     }
+    startForceLayout();
 }
 
+void Renderer::startForceLayout()
+{
+    std::vector<sf::Vector2f> initial;
+    initial.reserve(visuals_.size());
+    for (const auto& v : visuals_) initial.push_back(v.position);
 
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(network_.links().size());
+    for (const auto& link : network_.links()) {
+        if (!findNodeVisual(link.nodeA) || !findNodeVisual(link.nodeB)) continue;
+        edges.emplace_back(visualSlot_[link.nodeA], visualSlot_[link.nodeB]);
+    }
 
-void Renderer::draw() 
+    sf::Vector2u size = target_.getSize();
+    forceLayout_.start(std::move(initial), std::move(edges),
+                       sf::FloatRect(0.f, 0.f, static_cast<float>(size.x), static_cast<float>(size.y)));
+    laidOutTopology_ = network_.topologyVersion();
+    layoutDirty_ = true;
+    indexDirty_  = true;
+}
+
+void Renderer::syncTopology()
 {
-    // draw links
+    std::vector<NodeVisual> old;
+    old.swap(visuals_);
+    std::vector<int> oldSlot;
+    oldSlot.swap(visualSlot_);
+
+    auto oldPosition = [&](int id, sf::Vector2f& pos) {
+        if (id < 0 || static_cast<std::size_t>(id) >= oldSlot.size() || oldSlot[id] == -1) return false;
+        pos = old[oldSlot[id]].position;
+        return true;
+    };
+
+    sf::Vector2f center(target_.getSize().x / 2.f, target_.getSize().y / 2.f);
+    for (const auto& dev : network_.devices()) {
+        int id = dev->id();
+        sf::Vector2f pos;
+        if (!oldPosition(id, pos)) {
+            // a new device starts next to a neighbour it links to, if any
+            pos = center;
+            for (int lid : network_.linksOf(id)) {
+                const Link* l = network_.getLink(lid);
+                if (l && oldPosition(l->nodeA == id ? l->nodeB : l->nodeA, pos)) break;
+            }
+            pos += sf::Vector2f(static_cast<float>(id % 7) - 3.f, static_cast<float>(id % 5) - 2.f);
+        }
+        if (static_cast<std::size_t>(id) >= visualSlot_.size()) visualSlot_.resize(id + 1, -1);
+        visualSlot_[id] = static_cast<int>(visuals_.size());
+        visuals_.push_back(NodeVisual{ id, pos });
+    }
+    startForceLayout();
+}
+
+void Renderer::applyForceLayout()
+{
+    if (layoutPos_.size() != visuals_.size()) return;
+    for (std::size_t i = 0; i < visuals_.size(); ++i) visuals_[i].position = layoutPos_[i];
+    layoutDirty_ = true;
+    indexDirty_  = true;
+}
+
+// packets and nodes keep their old look: 4 px dots coloured by destination
+// port, 14 px discs with a 2 px white outline coloured by scope
+static constexpr float kPacketRadius  = 4.f;
+static constexpr float kNodeRadius    = 14.f;
+static constexpr float kNodeOutline   = 2.f;
+static constexpr int   kNodeSegments  = 24;
+static constexpr unsigned kSpriteSize = 16;
+
+static sf::Color packetColor(std::uint16_t dstPort)
+{
+    if (dstPort == 443) return sf::Color(255, 80, 80);  // HTTPS, reddish
+    if (dstPort == 53)  return sf::Color(80, 200, 255); // DNS, cyan-ish
+    return sf::Color(200, 200, 200);
+}
+
+static sf::Color scopeColor(NetworkScope scope)
+{
+    switch (scope) {
+    case NetworkScope::Local:      return sf::Color(100, 200, 100); // green-ish
+    case NetworkScope::Enterprise: return sf::Color(100, 150, 250); // blue-ish
+    case NetworkScope::Global:     return sf::Color(250, 150, 100); // orange-ish
+    }
+    return sf::Color::White;
+}
+
+void Renderer::buildPacketSprite()
+{
+    // white disc with a soft edge; vertex colours tint it per packet
+    sf::Image img;
+    img.create(kSpriteSize, kSpriteSize, sf::Color(255, 255, 255, 0));
+    const float c = kSpriteSize / 2.f;
+    for (unsigned y = 0; y < kSpriteSize; ++y) {
+        for (unsigned x = 0; x < kSpriteSize; ++x) {
+            float dx = x + 0.5f - c;
+            float dy = y + 0.5f - c;
+            float edge = c - std::sqrt(dx * dx + dy * dy); // > 0 inside
+            float alpha = std::max(0.f, std::min(1.f, edge));
+            img.setPixel(x, y, sf::Color(255, 255, 255, static_cast<sf::Uint8>(alpha * 255.f)));
+        }
+    }
+    packetSprite_.loadFromImage(img);
+    packetSprite_.setSmooth(true);
+}
+
+void Renderer::rebuildStatic()
+{
+    linkVerts_.clear();
     for (const auto& link : network_.links()) {
         const NodeVisual* a = findNodeVisual(link.nodeA);
         const NodeVisual* b = findNodeVisual(link.nodeB);
         if (!a || !b) continue;
+        linkVerts_.emplace_back(a->position);
+        linkVerts_.emplace_back(b->position);
+    }
 
-        sf::Vertex line[] = {
-            sf::Vertex(a->position),
-            sf::Vertex(b->position)
-        };
-        window_.draw(line, 2, sf::Lines);
-    }
-    // draw packets on links
-    for (const auto& f : network_.inFlightPackets()) {
-        const NodeVisual* from = findNodeVisual(f.fromNode);
-        const NodeVisual* to   = findNodeVisual(f.toNode);
-        if (!from || !to) continue;
-
-        sf::Vector2f pos = (1.f - static_cast<float>(f.t)) * from->position
-                           + static_cast<float>(f.t) * to->position;
-
-        sf::CircleShape p(4.f);
-        p.setOrigin(4.f, 4.f);
-        p.setPosition(pos);
-
-        // color by direction or port (simple scheme)
-        if (f.pkt.dstPort == 443) {
-            // HTTPS
-            p.setFillColor(sf::Color(255, 80, 80)); // reddish
-        } else if (f.pkt.dstPort == 53) {
-            // DNS
-            p.setFillColor(sf::Color(80, 200, 255)); // cyan-ish
-        } else {
-            p.setFillColor(sf::Color(200, 200, 200));
+    // one triangle per segment for the fill, two for the outline ring
+    nodeVerts_.clear();
+    nodeVertStart_.assign(visuals_.size(), -1);
+    const float step  = 2.f * 3.14159265f / kNodeSegments;
+    const float outer = kNodeRadius + kNodeOutline;
+    float x0 = 0.f, y0 = 0.f, x1 = 0.f, y1 = 0.f;
+    for (std::size_t i = 0; i < visuals_.size(); ++i) {
+        const NodeVisual& v = visuals_[i];
+        if (i == 0) {
+            x0 = x1 = v.position.x;
+            y0 = y1 = v.position.y;
         }
+        x0 = std::min(x0, v.position.x);
+        x1 = std::max(x1, v.position.x);
+        y0 = std::min(y0, v.position.y);
+        y1 = std::max(y1, v.position.y);
 
-        window_.draw(p);
+        const Device* dev = network_.getDevice(v.deviceId);
+        if (!dev) continue;
+        nodeVertStart_[i] = static_cast<int>(nodeVerts_.size());
+        sf::Color fill = scopeColor(dev->scope());
+        for (int k = 0; k < kNodeSegments; ++k) {
+            sf::Vector2f d0(std::cos(k * step), std::sin(k * step));
+            sf::Vector2f d1(std::cos((k + 1) * step), std::sin((k + 1) * step));
+            sf::Vector2f i0 = v.position + kNodeRadius * d0, i1 = v.position + kNodeRadius * d1;
+            sf::Vector2f o0 = v.position + outer * d0,       o1 = v.position + outer * d1;
+
+            nodeVerts_.emplace_back(v.position, fill);
+            nodeVerts_.emplace_back(i0, fill);
+            nodeVerts_.emplace_back(i1, fill);
+
+            nodeVerts_.emplace_back(i0, sf::Color::White);
+            nodeVerts_.emplace_back(o0, sf::Color::White);
+            nodeVerts_.emplace_back(o1, sf::Color::White);
+            nodeVerts_.emplace_back(i0, sf::Color::White);
+            nodeVerts_.emplace_back(o1, sf::Color::White);
+            nodeVerts_.emplace_back(i1, sf::Color::White);
+        }
     }
-    // draw nodes on top
-    for (const auto& v : visuals_) {
-        sf::CircleShape circle(14.f);
-        circle.setOrigin(14.f, 14.f);
-        circle.setPosition(v.position);
-        circle.setOutlineThickness(2.f);
-        circle.setOutlineColor(sf::Color::White);
+    worldBounds_ = sf::FloatRect(x0 - outer, y0 - outer, x1 - x0 + 2.f * outer, y1 - y0 + 2.f * outer);
 
-        auto dev = network_.getDevice(v.deviceId);
-        if (!dev) continue;
+    // static geometry lives on the GPU when the driver allows it
+    if (useBuffers_) {
+        linkBuffer_.create(linkVerts_.size());
+        linkBuffer_.update(linkVerts_.data());
+        nodeBuffer_.create(nodeVerts_.size());
+        nodeBuffer_.update(nodeVerts_.data());
+    }
+    builtTopology_ = network_.topologyVersion();
+    layoutDirty_   = false;
+}
+
+// pick tolerances, in pixels
+static constexpr float kNodePickRadius = kNodeRadius * 1.5f;
+static constexpr float kLinkPickDist   = 8.f;
+
+void Renderer::ensureIndex() const
+{
+    if (indexDirty_) rebuildIndex();
+}
+
+void Renderer::rebuildIndex() const
+{
+    linkSegs_.clear();
+    for (const auto& link : network_.links()) {
+        const NodeVisual* a = findNodeVisual(link.nodeA);
+        const NodeVisual* b = findNodeVisual(link.nodeB);
+        if (a && b) linkSegs_.push_back(LinkSegment{ link.id, a->position, b->position });
+    }
 
-        switch (dev->scope()) {
-        case NetworkScope::Local:
-            circle.setFillColor(sf::Color(100, 200, 100));   // green-ish
-            break;
-        case NetworkScope::Enterprise:
-            circle.setFillColor(sf::Color(100, 150, 250));   // blue-ish
-            break;
-        case NetworkScope::Global:
-            circle.setFillColor(sf::Color(250, 150, 100));   // orange-ish
-            break;
+    sf::FloatRect bounds;
+    if (!visuals_.empty()) {
+        float x0 = visuals_[0].position.x, x1 = x0;
+        float y0 = visuals_[0].position.y, y1 = y0;
+        for (const auto& v : visuals_) {
+            x0 = std::min(x0, v.position.x);
+            x1 = std::max(x1, v.position.x);
+            y0 = std::min(y0, v.position.y);
+            y1 = std::max(y1, v.position.y);
         }
-        window_.draw(circle);
+        bounds = sf::FloatRect(x0, y0, x1 - x0, y1 - y0);
     }
+
+    nodeGrid_.reset(bounds, visuals_.size());
+    for (std::size_t i = 0; i < visuals_.size(); ++i) {
+        nodeGrid_.insertPoint(static_cast<int>(i), visuals_[i].position, kNodePickRadius);
+    }
+    nodeGrid_.finish();
+
+    linkGrid_.reset(bounds, linkSegs_.size());
+    for (std::size_t i = 0; i < linkSegs_.size(); ++i) {
+        linkGrid_.insertSegment(static_cast<int>(i), linkSegs_[i].a, linkSegs_[i].b, kLinkPickDist);
+    }
+    linkGrid_.finish();
+    indexDirty_ = false;
 }
 
-int Renderer::pickNode(const sf::Vector2f& p) const 
+static constexpr float kMinZoom = 0.05f; // view size / target size
+static constexpr float kMaxZoom = 20.f;
+
+void Renderer::zoomAt(sf::Vector2i pixel, float factor)
+{
+    factor = std::max(kMinZoom / zoom_, std::min(kMaxZoom / zoom_, factor));
+    sf::Vector2f before = target_.mapPixelToCoords(pixel, view_);
+    view_.zoom(factor);
+    zoom_ *= factor;
+    sf::Vector2f after = target_.mapPixelToCoords(pixel, view_);
+    view_.move(before - after);
+}
+
+void Renderer::pan(sf::Vector2f pixelDelta)
+{
+    view_.move(-zoom_ * pixelDelta);
+}
+
+sf::Vector2f Renderer::toWorld(sf::Vector2i pixel) const
+{
+    return target_.mapPixelToCoords(pixel, view_);
+}
+
+sf::FloatRect Renderer::viewRect() const
+{
+    sf::Vector2f size = view_.getSize();
+    sf::Vector2f center = view_.getCenter();
+    return sf::FloatRect(center.x - size.x / 2.f, center.y - size.y / 2.f, size.x, size.y);
+}
+
+static bool containsRect(const sf::FloatRect& outer, const sf::FloatRect& inner)
+{
+    return inner.left >= outer.left && inner.top >= outer.top &&
+           inner.left + inner.width <= outer.left + outer.width &&
+           inner.top + inner.height <= outer.top + outer.height;
+}
+
+void Renderer::collectVisibleLinks(const sf::FloatRect& area)
+{
+    // segments are indexed padded by kLinkPickDist, more than a packet's
+    // radius, so this also finds every link with a packet in view
+    visibleLinks_.clear();
+    linkGrid_.query(area, [&](int i) { visibleLinks_.push_back(i); });
+}
+
+void Renderer::drawVisibleLinks()
+{
+    // linkSegs_ and linkVerts_ skip the same links, so segment i is
+    // vertices 2i and 2i+1
+    visibleVerts_.clear();
+    for (int i : visibleLinks_) {
+        std::size_t v = 2 * static_cast<std::size_t>(i);
+        if (v + 1 >= linkVerts_.size()) continue;
+        visibleVerts_.push_back(linkVerts_[v]);
+        visibleVerts_.push_back(linkVerts_[v + 1]);
+    }
+    if (!visibleVerts_.empty()) target_.draw(visibleVerts_.data(), visibleVerts_.size(), sf::Lines);
+}
+
+void Renderer::drawVisibleNodes(const sf::FloatRect& area)
+{
+    const float r = kNodeRadius + kNodeOutline;
+    const std::size_t perNode = kNodeSegments * 9;
+    visibleVerts_.clear();
+    nodeGrid_.query(area, [&](int i) {
+        int start = nodeVertStart_[i];
+        if (start == -1) return;
+        // the grid pads by the pick radius; trim to the drawn disc
+        sf::Vector2f p = visuals_[i].position;
+        if (p.x + r < area.left || p.x - r > area.left + area.width ||
+            p.y + r < area.top  || p.y - r > area.top + area.height) {
+            return;
+        }
+        visibleVerts_.insert(visibleVerts_.end(), nodeVerts_.begin() + start,
+                             nodeVerts_.begin() + start + perNode);
+    });
+    if (!visibleVerts_.empty()) target_.draw(visibleVerts_.data(), visibleVerts_.size(), sf::Triangles);
+}
+
+// a link switches to a strip above this many packets, or for every link
+// once the view is zoomed out this far (dots would be a pixel or two)
+static constexpr std::uint32_t kLodPacketsPerLink = 64;
+static constexpr float         kLodZoom           = 4.f;
+static constexpr float         kLodSaturation     = 8.f; // packets per bin for full opacity
+
+void Renderer::drawLinkStrips(const sf::FloatRect& area, bool cull)
 {
-    const float radius = 14.f;
-    const float radius2 = radius * radius;
+    // only last frame's marks need clearing, not one entry per link
+    for (int id : lodMarked_) lodLink_[id] = 0;
+    lodMarked_.clear();
+    stripVerts_.clear();
 
-    for (const auto& v : visuals_) {
-        sf::Vector2f d = p - v.position;
-        if (d.x * d.x + d.y * d.y <= radius2 * 1.5f * 1.5f) {
-            return v.deviceId;
+    const bool allLinks = zoom_ >= kLodZoom;
+    if (cull) {
+        for (int i : visibleLinks_) {
+            if (const Link* link = network_.getLink(linkSegs_[i].linkId)) addLinkStrip(*link, area, allLinks);
         }
+    } else {
+        for (const auto& link : network_.links()) addLinkStrip(link, area, allLinks);
     }
-    return -1;
+    if (!stripVerts_.empty()) target_.draw(stripVerts_.data(), stripVerts_.size(), sf::Triangles);
+}
+
+void Renderer::addLinkStrip(const Link& link, const sf::FloatRect& area, bool allLinks)
+{
+    const InFlightStore& flying = network_.inFlight();
+    constexpr int bins    = InFlightStore::kLinkBins;
+    constexpr int classes = InFlightStore::kTrafficClasses;
+    const sf::Color classColor[classes] = { packetColor(443), packetColor(53), packetColor(0) };
+
+    std::uint32_t total = flying.linkPackets(link.id);
+    if (total == 0 || (!allLinks && total < kLodPacketsPerLink)) return;
+    const NodeVisual* a = findNodeVisual(link.nodeA);
+    const NodeVisual* b = findNodeVisual(link.nodeB);
+    if (!a || !b) return;
+    if (static_cast<std::size_t>(link.id) >= lodLink_.size()) lodLink_.resize(link.id + 1, 0);
+    lodLink_[link.id] = 1;
+    lodMarked_.push_back(link.id);
+
+    sf::Vector2f pa = a->position, pb = b->position;
+    if (std::max(pa.x, pb.x) < area.left || std::min(pa.x, pb.x) > area.left + area.width ||
+        std::max(pa.y, pb.y) < area.top  || std::min(pa.y, pb.y) > area.top + area.height) {
+        return;
+    }
+    sf::Vector2f ab = pb - pa;
+    float len = std::sqrt(ab.x * ab.x + ab.y * ab.y);
+    if (len < 1e-3f) return;
+    sf::Vector2f side = (kPacketRadius / len) * sf::Vector2f(-ab.y, ab.x);
+
+    // bins run from each packet's sender; fold both directions onto a -> b
+    const int fwd = link.nodeA < link.nodeB ? 0 : 1;
+    const std::uint32_t* there = flying.linkBins(link.id, fwd);
+    const std::uint32_t* back  = flying.linkBins(link.id, 1 - fwd);
+    for (int k = 0; k < bins; ++k) {
+        float count[classes];
+        float sum = 0.f;
+        for (int c = 0; c < classes; ++c) {
+            count[c] = static_cast<float>(there[k * classes + c] + back[(bins - 1 - k) * classes + c]);
+            sum += count[c];
+        }
+        if (sum == 0.f) continue;
+
+        float r = 0.f, g = 0.f, bl = 0.f;
+        for (int c = 0; c < classes; ++c) {
+            r  += count[c] * classColor[c].r;
+            g  += count[c] * classColor[c].g;
+            bl += count[c] * classColor[c].b;
+        }
+        float alpha = 80.f + 175.f * std::min(1.f, sum / kLodSaturation);
+        sf::Color color(static_cast<sf::Uint8>(r / sum), static_cast<sf::Uint8>(g / sum),
+                        static_cast<sf::Uint8>(bl / sum), static_cast<sf::Uint8>(alpha));
+
+        sf::Vector2f p0 = pa + (static_cast<float>(k) / bins) * ab;
+        sf::Vector2f p1 = pa + (static_cast<float>(k + 1) / bins) * ab;
+        sf::Vertex v0(p0 - side, color), v1(p0 + side, color);
+        sf::Vertex v2(p1 + side, color), v3(p1 - side, color);
+        stripVerts_.push_back(v0);
+        stripVerts_.push_back(v1);
+        stripVerts_.push_back(v2);
+        stripVerts_.push_back(v0);
+        stripVerts_.push_back(v2);
+        stripVerts_.push_back(v3);
+    }
+}
+
+void Renderer::draw() 
+{
+    NETSIM_PROFILE_SCOPE(Render);
+    if (laidOutTopology_ != network_.topologyVersion()) syncTopology();
+    if (forceLayout_.poll(layoutPos_)) applyForceLayout();
+    if (layoutDirty_ || builtTopology_ != network_.topologyVersion()) rebuildStatic();
+
+    target_.setView(view_);
+    const sf::FloatRect area = viewRect();
+
+    // Zoomed in on part of a settled graph, gather what is on screen through
+    // the index. While the layout is still moving the index would be rebuilt
+    // every frame, so draw everything and let the GPU clip.
+    const bool cull = !containsRect(area, worldBounds_) && forceLayout_.converged();
+    if (cull) {
+        ensureIndex();
+        collectVisibleLinks(area);
+        drawVisibleLinks();
+    }
+    else if (useBuffers_) target_.draw(linkBuffer_);
+    else if (!linkVerts_.empty()) target_.draw(linkVerts_.data(), linkVerts_.size(), sf::Lines);
+
+    drawLinkStrips(area, cull);
+
+    // packets: one textured quad (two triangles) each, all in a single draw;
+    // culled, only the rows on links in view are looked at
+    const InFlightStore& flying = network_.inFlight();
+    packetVerts_.clear();
+    if (cull) {
+        for (int i : visibleLinks_) {
+            const int lid = linkSegs_[i].linkId;
+            if (static_cast<std::size_t>(lid) < lodLink_.size() && lodLink_[lid]) continue;
+            for (std::uint32_t row : flying.rowsOnLink(lid)) addPacketQuad(row, area);
+        }
+    } else {
+        packetVerts_.reserve(flying.size() * 6);
+        for (std::size_t i = 0; i < flying.size(); ++i) {
+            int lid = flying.linkId(i);
+            if (lid >= 0 && static_cast<std::size_t>(lid) < lodLink_.size() && lodLink_[lid]) continue;
+            addPacketQuad(i, area);
+        }
+    }
+    if (!packetVerts_.empty()) {
+        target_.draw(packetVerts_.data(), packetVerts_.size(), sf::Triangles,
+                     sf::RenderStates(&packetSprite_));
+    }
+
+    // nodes on top
+    if (cull) drawVisibleNodes(area);
+    else if (useBuffers_) target_.draw(nodeBuffer_);
+    else if (!nodeVerts_.empty()) target_.draw(nodeVerts_.data(), nodeVerts_.size(), sf::Triangles);
+
+    // panels and overlays are drawn in pixels
+    target_.setView(target_.getDefaultView());
+}
+
+void Renderer::addPacketQuad(std::size_t row, const sf::FloatRect& area)
+{
+    const InFlightStore& flying = network_.inFlight();
+    const NodeVisual* from = findNodeVisual(flying.fromNode(row));
+    const NodeVisual* to   = findNodeVisual(flying.toNode(row));
+    if (!from || !to) return;
+
+    float t = std::max(0.f, flying.progress(row)); // queued packets wait at the sender
+    sf::Vector2f pos = (1.f - t) * from->position + t * to->position;
+    if (pos.x + kPacketRadius < area.left || pos.x - kPacketRadius > area.left + area.width ||
+        pos.y + kPacketRadius < area.top  || pos.y - kPacketRadius > area.top + area.height) {
+        return;
+    }
+    sf::Color color = packetColor(flying.packet(row).dstPort);
+    const float s = static_cast<float>(kSpriteSize);
+
+    sf::Vertex tl({ pos.x - kPacketRadius, pos.y - kPacketRadius }, color, { 0.f, 0.f });
+    sf::Vertex tr({ pos.x + kPacketRadius, pos.y - kPacketRadius }, color, { s, 0.f });
+    sf::Vertex br({ pos.x + kPacketRadius, pos.y + kPacketRadius }, color, { s, s });
+    sf::Vertex bl({ pos.x - kPacketRadius, pos.y + kPacketRadius }, color, { 0.f, s });
+    packetVerts_.push_back(tl);
+    packetVerts_.push_back(tr);
+    packetVerts_.push_back(br);
+    packetVerts_.push_back(tl);
+    packetVerts_.push_back(br);
+    packetVerts_.push_back(bl);
+}
+
+int Renderer::pickNode(const sf::Vector2f& p) const 
+{
+    ensureIndex();
+    const float r = kNodePickRadius;
+    float best = r * r;
+    int bestId = -1;
+    nodeGrid_.query(sf::FloatRect(p.x - r, p.y - r, 2.f * r, 2.f * r), [&](int i) {
+        sf::Vector2f d = p - visuals_[i].position;
+        float d2 = d.x * d.x + d.y * d.y;
+        if (d2 <= best) {
+            best = d2;
+            bestId = visuals_[i].deviceId;
+        }
+    });
+    return bestId;
 }
 
 static float distanceToSegment(sf::Vector2f p, sf::Vector2f a, sf::Vector2f b)
@@ -139,19 +547,16 @@ static float distanceToSegment(sf::Vector2f p, sf::Vector2f a, sf::Vector2f b)
 
 int Renderer::pickLink(const sf::Vector2f& p) const 
 {
-    float bestDist = 8.f; // click tolerance in pixels
+    ensureIndex();
+    const float tol = kLinkPickDist; // click tolerance in pixels
+    float bestDist = tol;
     int bestId = -1;
-
-    for (const auto& link : network_.links()) {
-        const NodeVisual* a = findNodeVisual(link.nodeA);
-        const NodeVisual* b = findNodeVisual(link.nodeB);
-        if (!a || !b) continue;
-
-        float d = distanceToSegment(p, a->position, b->position);
+    linkGrid_.query(sf::FloatRect(p.x - tol, p.y - tol, 2.f * tol, 2.f * tol), [&](int i) {
+        float d = distanceToSegment(p, linkSegs_[i].a, linkSegs_[i].b);
         if (d < bestDist) {
             bestDist = d;
-            bestId = link.id;
+            bestId = linkSegs_[i].linkId;
         }
-    }
+    });
     return bestId;
-}
\ No newline at end of file
+}
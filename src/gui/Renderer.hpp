@@ -1,6 +1,8 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 #include "../sim/Network.hpp"
+#include "ForceLayout.hpp"
+#include "SpatialGrid.hpp"
 #include <vector>
 
 struct NodeVisual 
@@ -12,18 +14,90 @@ struct NodeVisual
 class Renderer 
 {
 public:
-    Renderer(sf::RenderWindow& window, Network& network);
+    Renderer(sf::RenderTarget& target, Network& network);
 
+    // seed every node on a circle and let the force layout take it from there
     void updateLayout();
     void draw();
 
+    // Camera over the main view. zoomAt keeps the world point under `pixel`
+    // fixed; factor < 1 zooms in. pan moves the scene by a pixel delta.
+    void zoomAt(sf::Vector2i pixel, float factor);
+    void pan(sf::Vector2f pixelDelta);
+    sf::Vector2f toWorld(sf::Vector2i pixel) const;
+
     int pickNode(const sf::Vector2f& point) const;
     int pickLink(const sf::Vector2f& point) const;
     const std::vector<NodeVisual>& visuals() const {return visuals_; }
 private:
     const NodeVisual* findNodeVisual(int deviceId) const;
+    void buildPacketSprite();
+    // link lines and node discs, redone only when the topology or layout changes
+    void rebuildStatic();
+    // Hit-test grids over node positions and link segments. Built lazily:
+    // while the layout is still moving, only when something asks.
+    void ensureIndex() const;
+    void rebuildIndex() const;
+    // keep positions of known nodes, place new ones, restart the layout
+    void syncTopology();
+    void startForceLayout();
+    void applyForceLayout();
+    // world rectangle the camera currently shows
+    sf::FloatRect viewRect() const;
+    // links that overlap `area`, gathered through the index into
+    // visibleLinks_; the culled link, strip and packet passes use only those
+    void collectVisibleLinks(const sf::FloatRect& area);
+    void drawVisibleLinks();
+    void drawVisibleNodes(const sf::FloatRect& area);
+    // Busy links (or all links when zoomed far out) show their packets as a
+    // strip of bins coloured by protocol mix instead of one dot per packet.
+    // Marks those links in lodLink_ so the packet pass skips them. Culled,
+    // only visibleLinks_ are considered.
+    void drawLinkStrips(const sf::FloatRect& area, bool cull);
+    void addLinkStrip(const Link& link, const sf::FloatRect& area, bool allLinks);
+    // one packet dot, if in-flight row `row` is inside `area`
+    void addPacketQuad(std::size_t row, const sf::FloatRect& area);
 
-    sf::RenderWindow&       window_;
+    sf::RenderTarget&       target_;
     Network&                network_;
     std::vector<NodeVisual> visuals_;
+    std::vector<int>        visualSlot_; // device id -> index in visuals_, -1 if none
+
+    // Static geometry is kept in vertex buffers when the GPU supports them,
+    // otherwise drawn from the CPU-side copies. Packets are rebuilt every
+    // frame into one textured triangle list.
+    bool                    useBuffers_;
+    sf::VertexBuffer        linkBuffer_{ sf::Lines, sf::VertexBuffer::Dynamic };
+    sf::VertexBuffer        nodeBuffer_{ sf::Triangles, sf::VertexBuffer::Dynamic };
+    std::vector<sf::Vertex> linkVerts_;
+    std::vector<sf::Vertex> nodeVerts_;
+    std::vector<sf::Vertex> packetVerts_;
+    std::vector<sf::Vertex> stripVerts_;
+    std::vector<char>       lodLink_;       // link id -> drawn as a strip this frame
+    std::vector<int>        lodMarked_;     // ids set in lodLink_, to clear next frame
+    std::vector<int>        visibleLinks_;  // linkSegs_ indices in view, when culling
+    sf::Texture             packetSprite_;
+    std::vector<int>        nodeVertStart_; // visuals_ index -> first vertex, -1 if not drawn
+    std::vector<sf::Vertex> visibleVerts_;  // culled links, then culled nodes
+    sf::FloatRect           worldBounds_;   // everything rebuildStatic drew
+    bool                    layoutDirty_   = true;
+    std::uint64_t           builtTopology_ = 0;
+    std::uint64_t           laidOutTopology_ = 0;
+
+    sf::View                view_;
+    float                   zoom_ = 1.f; // view size / target size
+
+    // positions arrive from the worker in visuals_ order
+    ForceLayout               forceLayout_;
+    std::vector<sf::Vector2f> layoutPos_;
+
+    struct LinkSegment
+    {
+        int          linkId;
+        sf::Vector2f a, b;
+    };
+    mutable SpatialGrid              nodeGrid_; // items index visuals_
+    mutable SpatialGrid              linkGrid_; // items index linkSegs_
+    mutable std::vector<LinkSegment> linkSegs_;
+    mutable bool                     indexDirty_ = true;
 };
@@ -0,0 +1,108 @@
+#include "SpatialGrid.hpp"
+#include <algorithm>
+#include <cmath>
+
+void SpatialGrid::reset(const sf::FloatRect& bounds, std::size_t itemsHint)
+{
+    // about two items per cell, at most 1024 x 1024 cells
+    const float w = std::max(bounds.width, 1.f);
+    const float h = std::max(bounds.height, 1.f);
+    const float n = static_cast<float>(std::max<std::size_t>(itemsHint, 1));
+    cell_ = std::max(std::sqrt(w * h * 2.f / n), std::max(w, h) / 1024.f);
+    cell_ = std::max(cell_, 1.f);
+    invCell_ = 1.f / cell_;
+
+    originX_ = bounds.left;
+    originY_ = bounds.top;
+    cols_    = static_cast<int>(w * invCell_) + 1;
+    rows_    = static_cast<int>(h * invCell_) + 1;
+
+    pending_.clear();
+    cellStart_.clear();
+    items_.clear();
+}
+
+bool SpatialGrid::cellRange(float x0, float y0, float x1, float y1,
+                            int& c0, int& r0, int& c1, int& r1) const
+{
+    if (cols_ == 0) return false;
+    c0 = static_cast<int>(std::floor((x0 - originX_) * invCell_));
+    r0 = static_cast<int>(std::floor((y0 - originY_) * invCell_));
+    c1 = static_cast<int>(std::floor((x1 - originX_) * invCell_));
+    r1 = static_cast<int>(std::floor((y1 - originY_) * invCell_));
+    if (c1 < 0 || r1 < 0 || c0 >= cols_ || r0 >= rows_) return false;
+    c0 = std::max(c0, 0);
+    r0 = std::max(r0, 0);
+    c1 = std::min(c1, cols_ - 1);
+    r1 = std::min(r1, rows_ - 1);
+    return true;
+}
+
+void SpatialGrid::add(int item, int col, int row)
+{
+    pending_.emplace_back(static_cast<std::uint32_t>(row * cols_ + col), item);
+}
+
+void SpatialGrid::insertPoint(int item, sf::Vector2f p, float radius)
+{
+    int c0, r0, c1, r1;
+    if (!cellRange(p.x - radius, p.y - radius, p.x + radius, p.y + radius, c0, r0, c1, r1)) return;
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) add(item, c, r);
+    }
+}
+
+void SpatialGrid::insertSegment(int item, sf::Vector2f a, sf::Vector2f b, float pad)
+{
+    if (a.y > b.y) std::swap(a, b);
+    int c0, r0, c1, r1;
+    if (!cellRange(std::min(a.x, b.x) - pad, a.y - pad, std::max(a.x, b.x) + pad, b.y + pad,
+                   c0, r0, c1, r1)) {
+        return;
+    }
+
+    // row by row, only the columns the segment crosses within that row's
+    // y-span, so a long diagonal link costs O(length), not its bounding box
+    const float dy = b.y - a.y;
+    for (int r = r0; r <= r1; ++r) {
+        float y0 = originY_ + r * cell_ - pad;
+        float y1 = y0 + cell_ + 2.f * pad;
+        float xa, xb;
+        if (dy <= 1e-6f) {
+            xa = a.x;
+            xb = b.x;
+        } else {
+            float t0 = std::max(0.f, (y0 - a.y) / dy);
+            float t1 = std::min(1.f, (y1 - a.y) / dy);
+            if (t0 > t1) continue;
+            xa = a.x + (b.x - a.x) * t0;
+            xb = a.x + (b.x - a.x) * t1;
+        }
+        if (xa > xb) std::swap(xa, xb);
+        int ca = std::max(c0, static_cast<int>(std::floor((xa - pad - originX_) * invCell_)));
+        int cb = std::min(c1, static_cast<int>(std::floor((xb + pad - originX_) * invCell_)));
+        for (int c = ca; c <= cb; ++c) add(item, c, r);
+    }
+}
+
+void SpatialGrid::finish()
+{
+    // counting sort of the pending pairs by cell
+    const std::size_t cells = cellCount();
+    cellStart_.assign(cells + 1, 0);
+    int maxItem = -1;
+    for (const auto& [cell, item] : pending_) {
+        ++cellStart_[cell + 1];
+        maxItem = std::max(maxItem, item);
+    }
+    for (std::size_t c = 0; c < cells; ++c) cellStart_[c + 1] += cellStart_[c];
+
+    items_.resize(pending_.size());
+    std::vector<std::uint32_t> fill(cellStart_.begin(), cellStart_.end() - 1);
+    for (const auto& [cell, item] : pending_) items_[fill[cell]++] = item;
+    pending_.clear();
+    pending_.shrink_to_fit();
+
+    seen_.assign(static_cast<std::size_t>(maxItem + 1), 0u);
+    stamp_ = 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over a set of points (with a radius) and line segments, for
+// hit-testing and visibility queries. Items are plain ints chosen by the
+// caller. Build it by reset(), insert*(), then finish(); queries report each
+// item at most once.
+class SpatialGrid
+{
+public:
+    // bounds of everything that will be inserted; itemsHint sizes the cells
+    void reset(const sf::FloatRect& bounds, std::size_t itemsHint);
+    void insertPoint(int item, sf::Vector2f p, float radius);
+    // every cell the segment passes within `pad` of
+    void insertSegment(int item, sf::Vector2f a, sf::Vector2f b, float pad);
+    // pack the cells; must be called before querying
+    void finish();
+
+    // calls fn(item) for each item whose cells overlap `area`
+    template <typename Fn>
+    void query(const sf::FloatRect& area, Fn&& fn) const
+    {
+        int c0, r0, c1, r1;
+        if (cellStart_.empty()) return;
+        if (!cellRange(area.left, area.top, area.left + area.width, area.top + area.height,
+                       c0, r0, c1, r1)) {
+            return;
+        }
+        if (++stamp_ == 0) { // wrapped: clear the marks once
+            std::fill(seen_.begin(), seen_.end(), 0u);
+            stamp_ = 1;
+        }
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                std::size_t cell = static_cast<std::size_t>(r) * cols_ + c;
+                for (std::uint32_t k = cellStart_[cell]; k < cellStart_[cell + 1]; ++k) {
+                    int item = items_[k];
+                    if (seen_[item] == stamp_) continue;
+                    seen_[item] = stamp_;
+                    fn(item);
+                }
+            }
+        }
+    }
+
+    std::size_t cellCount() const { return static_cast<std::size_t>(cols_) * rows_; }
+
+private:
+    // clamps to the grid; false if the box misses it entirely
+    bool cellRange(float x0, float y0, float x1, float y1, int& c0, int& r0, int& c1, int& r1) const;
+    void add(int item, int col, int row);
+
+    float originX_ = 0.f, originY_ = 0.f;
+    float invCell_ = 1.f;
+    float cell_    = 1.f;
+    int   cols_    = 0, rows_ = 0;
+
+    // (cell, item) pairs while building, then cells packed CSR style
+    std::vector<std::pair<std::uint32_t, int>> pending_;
+    std::vector<std::uint32_t>                 cellStart_;
+    std::vector<int>                           items_;
+
+    // per-item query marks, so an item spanning cells is reported once
+    mutable std::vector<std::uint32_t> seen_;
+    mutable std::uint32_t              stamp_ = 0;
+};
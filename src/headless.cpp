@@ -0,0 +1,374 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sim/Network.hpp"
+#include "sim/Simulation.hpp"
+#include "sim/ParallelSimulation.hpp"
+#include "sim/HomeScenario.hpp"
+#include "sim/PacketCapture.hpp"
+#include "sim/PcapWriter.hpp"
+#include "sim/Snapshot.hpp"
+#include "sim/TopologyFile.hpp"
+#include "sim/TraceReplay.hpp"
+#include "sim/TrafficGenerator.hpp"
+
+// Runs the simulation without a window or frame cap and prints summary
+// stats. Usage: 40NetSim-headless [--horizon s] [--step s] [--seed n]
+//                                 [--homes n] [--threads n] [--traffic file]
+//                                 [--topology file] [--pcap file]
+//                                 [--capture-link id] [--capture-device id]
+//                                 [--replay file] [--replay-speed x]
+//                                 [--save file] [--restore file]
+//                                 [--warmup s --fork n]
+
+static void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " [--horizon seconds] [--step seconds] [--seed n]\n"
+              << "          [--homes n] [--threads n] [--traffic file] [--topology file]\n"
+              << "          [--pcap file] [--capture-link id] [--capture-device id]\n"
+              << "          [--replay file] [--replay-speed x]\n"
+              << "          [--save file] [--restore file] [--warmup s --fork n]\n"
+              << "  --horizon  simulated time to run (default 3600)\n"
+              << "  --step     largest step while packets are on the wire (default 0.01)\n"
+              << "  --seed     global RNG seed; streams are keyed by it and device id, so\n"
+              << "             results do not depend on --threads (default 1)\n"
+              << "  --homes    number of independent home LANs (default 1)\n"
+              << "  --threads  worker threads, 0 = one per core (default 1)\n"
+              << "  --traffic  traffic profiles for every home (default: built in)\n"
+              << "  --topology run a topology file (text or binary) in one region\n"
+              << "             instead of the homes; traffic only with --traffic\n"
+              << "  --pcap     write the traffic as a capture, pcapng if the name ends in\n"
+              << "             .pcapng, else pcap; with several regions, region r > 0\n"
+              << "             goes to <file>.r\n"
+              << "  --capture-link, --capture-device\n"
+              << "             capture only these links or devices' links (repeatable)\n"
+              << "  --replay   also play a pcap or native trace into the network, in one\n"
+              << "             region; addresses no device owns are hashed onto devices\n"
+              << "  --replay-speed\n"
+              << "             simulated speed-up of the trace's timestamps (default 1)\n"
+              << "  --save     snapshot the run when it reaches the horizon\n"
+              << "  --restore  continue a saved run to the horizon instead of building one\n"
+              << "  --warmup, --fork\n"
+              << "             run to the warmup time, then fork n copy-on-write copies\n"
+              << "             that each reseed their traffic and run on to the horizon\n"
+              << "  snapshots and forks need --threads 1; --save does not cover\n"
+              << "  --replay, and --fork cannot be combined with --pcap or --save\n";
+}
+
+int main(int argc, char** argv)
+{
+    double        horizon = 3600.0;
+    double        maxStep = 0.01;
+    std::uint32_t seed    = 1;
+    long          homes   = 1;
+    long          threads = 1;
+    const char*   trafficPath = nullptr;
+    const char*   topologyPath = nullptr;
+    const char*   pcapPath = nullptr;
+    const char*   replayPath = nullptr;
+    double        replaySpeed = 1.0;
+    const char*   savePath = nullptr;
+    const char*   restorePath = nullptr;
+    double        warmup = 0.0;
+    long          forkCount = 0;
+    std::vector<int> captureLinks, captureDevices;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(arg, "--horizon") == 0) {
+            horizon = std::atof(value);
+        } else if (std::strcmp(arg, "--step") == 0) {
+            maxStep = std::atof(value);
+        } else if (std::strcmp(arg, "--seed") == 0) {
+            seed = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--homes") == 0) {
+            homes = std::atol(value);
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            threads = std::atol(value);
+        } else if (std::strcmp(arg, "--traffic") == 0) {
+            trafficPath = value;
+        } else if (std::strcmp(arg, "--topology") == 0) {
+            topologyPath = value;
+        } else if (std::strcmp(arg, "--pcap") == 0) {
+            pcapPath = value;
+        } else if (std::strcmp(arg, "--replay") == 0) {
+            replayPath = value;
+        } else if (std::strcmp(arg, "--replay-speed") == 0) {
+            replaySpeed = std::atof(value);
+        } else if (std::strcmp(arg, "--save") == 0) {
+            savePath = value;
+        } else if (std::strcmp(arg, "--restore") == 0) {
+            restorePath = value;
+        } else if (std::strcmp(arg, "--warmup") == 0) {
+            warmup = std::atof(value);
+        } else if (std::strcmp(arg, "--fork") == 0) {
+            forkCount = std::atol(value);
+        } else if (std::strcmp(arg, "--capture-link") == 0) {
+            captureLinks.push_back(std::atoi(value));
+        } else if (std::strcmp(arg, "--capture-device") == 0) {
+            captureDevices.push_back(std::atoi(value));
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (horizon <= 0.0 || maxStep <= 0.0 || homes < 1 || threads < 0 || replaySpeed <= 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+    // a snapshot is one region's state, and a forked child has no threads
+    // but its own
+    const bool snapshots = savePath || restorePath || forkCount > 0;
+    if (forkCount < 0 || warmup < 0.0 || (forkCount > 0 && (warmup >= horizon || pcapPath || savePath)) ||
+        (snapshots && threads != 1) || (savePath && replayPath) || (restorePath && topologyPath)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<TrafficProfile> traffic;
+    if (trafficPath) {
+        std::ifstream in(trafficPath);
+        std::string error;
+        if (!in) {
+            std::cerr << trafficPath << ": cannot open\n";
+            return 1;
+        }
+        if (!parseTrafficProfiles(in, traffic, error)) {
+            std::cerr << trafficPath << ": " << error << "\n";
+            return 1;
+        }
+    }
+
+    // each home is its own island, so spread them over one region per thread
+    std::size_t threadCount = static_cast<std::size_t>(threads);
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    // a loaded topology is one region: its gateways may sit anywhere in it;
+    // so is a replay, whose packets may run between any two devices
+    std::size_t regions = (topologyPath || replayPath)
+        ? 1 : std::min(static_cast<std::size_t>(homes), threadCount);
+    ParallelSimulation par(regions, threadCount);
+
+    std::vector<std::unique_ptr<HomeScenario>> scenarios;
+    std::unique_ptr<TrafficGenerator> topologyTraffic;
+    std::uint64_t nextPacketId = 1;
+    std::uint64_t generated = 0;
+    int nextId = 0;
+    if (restorePath) {
+        std::string error;
+        SnapshotReader in;
+        bool ok = in.readFile(restorePath, error) &&
+                  par.network(0).restore(in, error) &&
+                  par.simulation(0).restore(in, error);
+        if (ok) {
+            in.get(nextPacketId);
+            const std::size_t count = in.getCount(sizeof(int));
+            for (std::size_t h = 0; h < count && in.ok(); ++h) {
+                scenarios.push_back(std::make_unique<HomeScenario>(
+                    par.network(0), par.simulation(0), seed));
+                scenarios.back()->restore(in);
+            }
+            if (in.get<std::uint8_t>() != 0) {
+                topologyTraffic = std::make_unique<TrafficGenerator>(
+                    par.network(0), par.simulation(0), seed, nextPacketId);
+                topologyTraffic->restore(in);
+            }
+            ok = in.ok() && in.atEnd();
+            if (!ok) error = "owner sections are malformed or truncated";
+        }
+        if (!ok) {
+            std::cerr << restorePath << ": " << error << "\n";
+            return 1;
+        }
+        std::cout << "restored          " << par.network(0).devices().size() << " devices at "
+                  << par.simulation(0).time() << " s\n";
+        homes = 0;
+    } else if (topologyPath) {
+        std::string error;
+        auto loadStart = std::chrono::steady_clock::now();
+        if (!loadTopologyFile(par.network(0), topologyPath, error)) {
+            std::cerr << topologyPath << ": " << error << "\n";
+            return 1;
+        }
+        std::cout << "topology          " << par.network(0).devices().size() << " devices, "
+                  << par.network(0).links().size() << " links loaded in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count()
+                  << " s\n";
+        if (trafficPath) {
+            topologyTraffic = std::make_unique<TrafficGenerator>(
+                par.network(0), par.simulation(0), seed, nextPacketId);
+            for (const auto& p : traffic) topologyTraffic->addProfile(p);
+            std::vector<int> devices;
+            for (const auto& dev : par.network(0).devices()) devices.push_back(dev->id());
+            topologyTraffic->start(devices);
+        }
+        homes = 0;
+    }
+    for (long h = 0; h < homes; ++h) {
+        std::size_t r = static_cast<std::size_t>(h) % regions;
+        scenarios.push_back(std::make_unique<HomeScenario>(
+            par.network(r), par.simulation(r), seed, nextId));
+        scenarios.back()->build();
+        if (trafficPath) scenarios.back()->setTraffic(traffic);
+        scenarios.back()->start();
+        nextId = scenarios.back()->nextFreeId();
+    }
+
+    TraceReader trace;
+    std::unique_ptr<TraceReplay> replay;
+    if (replayPath) {
+        std::string error;
+        if (!trace.open(replayPath, error)) {
+            std::cerr << replayPath << ": " << error << "\n";
+            return 1;
+        }
+        replay = std::make_unique<TraceReplay>(par.network(0), par.simulation(0), trace, nextPacketId);
+        std::vector<int> devices;
+        for (const auto& dev : par.network(0).devices()) devices.push_back(dev->id());
+        TraceReplay::Options options;
+        options.speed = replaySpeed;
+        replay->start(devices, options);
+    }
+
+    // one writer per region: each region's tap runs on whichever thread
+    // runs that region
+    std::vector<std::unique_ptr<PcapWriter>> writers;
+    std::vector<std::unique_ptr<PacketCapture>> captures;
+    if (pcapPath) {
+        const std::string base = pcapPath;
+        const std::size_t n = base.size();
+        const CaptureFormat format = (n >= 7 && base.compare(n - 7, 7, ".pcapng") == 0)
+            ? CaptureFormat::PcapNg : CaptureFormat::Pcap;
+        for (std::size_t r = 0; r < regions; ++r) {
+            const std::string path = r == 0 ? base : base + "." + std::to_string(r);
+            std::string error;
+            writers.push_back(std::make_unique<PcapWriter>());
+            if (!writers.back()->open(path, format, error)) {
+                std::cerr << path << ": " << error << "\n";
+                return 1;
+            }
+            captures.push_back(std::make_unique<PacketCapture>(par.network(r), *writers.back()));
+            for (int id : captureLinks) captures.back()->captureLink(id);
+            for (int id : captureDevices) captures.back()->captureDevice(id);
+            captures.back()->attach();
+        }
+    }
+
+    // whoever owns a timer saves its id; all owners go after the network
+    // and simulation they were built on
+    auto saveRun = [&](const char* path) {
+        SnapshotWriter out;
+        std::string error;
+        if (!par.network(0).save(out, error)) {
+            std::cerr << path << ": " << error << "\n";
+            return false;
+        }
+        par.simulation(0).save(out);
+        out.put(nextPacketId);
+        out.put<std::uint64_t>(scenarios.size());
+        for (const auto& sc : scenarios) sc->save(out);
+        out.put<std::uint8_t>(topologyTraffic != nullptr);
+        if (topologyTraffic) topologyTraffic->save(out);
+        if (!out.writeFile(path, error)) {
+            std::cerr << path << ": " << error << "\n";
+            return false;
+        }
+        return true;
+    };
+
+    // runs to the horizon and reports in one write, so the reports of
+    // forked runs do not interleave
+    auto finish = [&](const std::string& title) {
+        std::ostringstream out;
+        if (!title.empty()) out << title << "\n";
+
+        auto wallStart = std::chrono::steady_clock::now();
+        par.run(horizon, maxStep);
+        double wall = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - wallStart).count();
+
+        std::size_t inFlight = 0;
+        for (std::size_t r = 0; r < regions; ++r) inFlight += par.network(r).inFlight().size();
+        const NetworkStats st = par.stats();
+        for (const auto& sc : scenarios) generated += sc->packetsGenerated();
+        generated += nextPacketId - 1 + st.packetsEmitted;
+
+        out << "simulated time    " << par.time() << " s\n"
+            << "wall time         " << wall << " s\n"
+            << "speedup           " << (wall > 0.0 ? par.time() / wall : 0.0) << "x\n"
+            << "regions/threads   " << par.regionCount() << "/" << par.threadCount() << "\n"
+            << "sync windows      " << par.windows() << "\n"
+            << "steps             " << par.steps() << "\n"
+            << "events processed  " << par.eventsProcessed() << "\n"
+            << "packets generated " << generated << "\n"
+            << "packets sent      " << st.packetsSent << "\n"
+            << "packets delivered " << st.packetsDelivered << "\n"
+            << "packets forwarded " << st.packetsForwarded << "\n"
+            << "packets dropped   " << st.packetsDropped << "\n"
+            << "  tail drops      " << st.tailDrops << "\n"
+            << "bytes delivered   " << st.bytesDelivered << "\n"
+            << "still in flight   " << inFlight << "\n";
+
+        if (replay) {
+            out << "replay            " << (replay->done() ? "finished" : "running") << "\n"
+                << "  injected        " << replay->injected() << "\n"
+                << "  unmapped        " << replay->unmapped() << "\n"
+                << "  unroutable      " << replay->unroutable() << "\n"
+                << "  not TCP/UDP     " << trace.skipped() << "\n";
+        }
+
+        bool ok = true;
+        if (!writers.empty()) {
+            std::uint64_t captured = 0, dropped = 0;
+            captures.clear();
+            for (auto& w : writers) {
+                captured += w->packets();
+                dropped  += w->dropped();
+                std::string error;
+                if (!w->close(error)) {
+                    std::cerr << pcapPath << ": " << error << "\n";
+                    ok = false;
+                }
+            }
+            out << "packets captured  " << captured << "\n"
+                << "  capture drops   " << dropped << "\n";
+        }
+        if (savePath) {
+            ok = saveRun(savePath) && ok;
+            if (ok) out << "saved to          " << savePath << "\n";
+        }
+        std::cout << out.str() << std::flush;
+        return ok ? 0 : 1;
+    };
+
+    if (forkCount > 0) {
+        par.run(warmup, maxStep);
+        std::cout << "warmed up to      " << par.time() << " s\n";
+        std::size_t failed = forkRuns(static_cast<std::size_t>(forkCount), [&](std::size_t i) {
+            const std::uint32_t runSeed = seed + 1000u * static_cast<std::uint32_t>(i + 1);
+            for (std::size_t h = 0; h < scenarios.size(); ++h) {
+                scenarios[h]->reseed(runSeed);
+            }
+            if (topologyTraffic) topologyTraffic->reseed(runSeed);
+            return finish("run " + std::to_string(i) + ", seed " + std::to_string(runSeed));
+        });
+        return failed ? 1 : 0;
+    }
+    return finish(std::string());
+}
@@ -1,7 +1,13 @@
 #pragma once
+#include "IpAddress.hpp"
 #include <cstdint>
+#include <limits>
 #include <string>
 
+class Network;
+class SnapshotReader;
+class SnapshotWriter;
+
 enum class NetworkScope 
 {
     Local,
@@ -9,12 +15,12 @@ enum class NetworkScope
     Global
 };
 
-enum class TransportProtocol {
+enum class TransportProtocol : std::uint8_t {
     TCP,
     UDP
 };
 
-enum class ApplicationProtocol
+enum class ApplicationProtocol : std::uint8_t
 {
     HTTPS,
     HTTP,
@@ -22,18 +28,31 @@ enum class ApplicationProtocol
     OTHER
 };
 
+// Plain data, no heap members: copied freely along the hot path.
+// Addresses are binary; format them with formatAddress at the UI boundary.
 struct Packet {
     std::uint64_t id;
     int srcNodeId;
     int dstNodeId;
-    std::size_t sizeBytes;
+    std::uint32_t sizeBytes;
     double createdAt;
-    std::string srcIp;
-    std::string dstIp;
+    IpAddress srcIp = 0;
+    IpAddress dstIp = 0;
     std::uint16_t srcPort = 0;
     std::uint16_t dstPort = 0;
     TransportProtocol transport = TransportProtocol::TCP;
     ApplicationProtocol app = ApplicationProtocol::OTHER;
+    AddressFamily family = AddressFamily::IPv4;
+};
+static_assert(sizeof(Packet) <= 64, "Packet should fit in one cache line");
+
+// concrete device types, as stored in topology files and snapshots
+enum class DeviceKind : std::uint8_t
+{
+    Router,
+    Home,
+    IoT,
+    Other // not stored; a network holding one cannot be snapshotted
 };
 
 struct DeviceInfo 
@@ -50,19 +69,52 @@ struct DeviceInfo
 class Device 
 {
 public:
-    explicit Device(int id, NetworkScope scope)
-        : id_(id), scope_(scope) {}
+    explicit Device(int id, NetworkScope scope, IpAddress ip = 0)
+        : id_(id), scope_(scope), ip_(ip) {}
 
     virtual ~Device() = default;
     virtual DeviceInfo info() const = 0;
 
     int id() const { return id_; }
     NetworkScope scope() const { return scope_; }
+    // the device's own address, 0 if it has none; a plain field, so hot
+    // paths can read it without knowing the concrete type
+    IpAddress ip() const { return ip_; }
+
+    static constexpr double kNever = std::numeric_limits<double>::infinity();
 
-    virtual void tick(double now) = 0; // called on every sim step
+    // Called once, at the end of the first step that reaches the time asked
+    // for with wakeAt(); the request is used up by then. A device that only
+    // reacts to packets never asks, and costs nothing per step.
+    virtual void tick(double now) { (void)now; }
     virtual void onPacketReceived(const Packet& pkt) = 0; // called on packet arrival
 
+    // the pending wakeup, kNever if none
+    double nextWakeup() const { return wakeup_; }
+
+    // snapshot support: the kind picks the type to rebuild, then the state
+    // beyond id and scope is written and read back in the same order.
+    // The wakeup is not saved: restoreState re-arms it from that state.
+    virtual DeviceKind kind() const { return DeviceKind::Other; }
+    virtual void saveState(SnapshotWriter& out) const { (void)out; }
+    virtual void restoreState(SnapshotReader& in) { (void)in; }
+
 protected:
+    // ask for tick() at `at`, replacing any earlier request; may be called
+    // before the device is added to a network, which then picks it up
+    void wakeAt(double at);
+    // Emit pkt toward pkt.dstNodeId, `delay` seconds after the end of the
+    // current step; createdAt is set to that step's end. It waits in the
+    // network's outbox, which routes it from this device like any other
+    // packet; with no network, or no route, it is dropped.
+    void send(const Packet& pkt, double delay);
+
     int id_;
     NetworkScope scope_;
+    IpAddress ip_;
+
+private:
+    friend class Network;
+    double   wakeup_  = kNever;
+    Network* network_ = nullptr; // the one holding this device, if any
 };
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+enum class EventKind : std::uint8_t
+{
+    SendPacket, // put a scheduled packet on its link
+    Deliver,    // hand a packet straight to its destination device
+    Timer       // run a scheduled callback
+};
+
+struct Event
+{
+    double        time;
+    std::uint64_t seq;  // insertion order, breaks ties between equal times
+    EventKind     kind;
+    std::uint32_t slot; // index into the owner's payload table for this kind
+};
+
+// Binary min-heap ordered by (time, seq). push/pop are O(log n), top is O(1).
+class EventQueue
+{
+public:
+    // returns the event's seq, unique for the life of the queue
+    std::uint64_t push(double time, EventKind kind, std::uint32_t slot)
+    {
+        heap_.push_back(Event{ time, nextSeq_, kind, slot });
+        siftUp(heap_.size() - 1);
+        return nextSeq_++;
+    }
+
+    const Event& top() const { return heap_.front(); }
+
+    Event pop()
+    {
+        Event ev = heap_.front();
+        heap_.front() = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) siftDown(0);
+        return ev;
+    }
+
+    bool        empty() const { return heap_.empty(); }
+    std::size_t size()  const { return heap_.size(); }
+    void        reserve(std::size_t n) { heap_.reserve(n); }
+
+    // the heap array as is, and its replacement by one saved from here
+    const std::vector<Event>& events() const { return heap_; }
+    std::uint64_t             nextSeq() const { return nextSeq_; }
+    void assign(std::vector<Event> heap, std::uint64_t nextSeq)
+    {
+        heap_    = std::move(heap);
+        nextSeq_ = nextSeq;
+    }
+
+private:
+    static bool before(const Event& a, const Event& b)
+    {
+        if (a.time != b.time) return a.time < b.time;
+        return a.seq < b.seq;
+    }
+
+    void siftUp(std::size_t i)
+    {
+        Event ev = heap_[i];
+        while (i > 0) {
+            std::size_t parent = (i - 1) / 2;
+            if (!before(ev, heap_[parent])) break;
+            heap_[i] = heap_[parent];
+            i = parent;
+        }
+        heap_[i] = ev;
+    }
+
+    void siftDown(std::size_t i)
+    {
+        const std::size_t n = heap_.size();
+        Event ev = heap_[i];
+        for (;;) {
+            std::size_t child = 2 * i + 1;
+            if (child >= n) break;
+            if (child + 1 < n && before(heap_[child + 1], heap_[child])) ++child;
+            if (!before(heap_[child], ev)) break;
+            heap_[i] = heap_[child];
+            i = child;
+        }
+        heap_[i] = ev;
+    }
+
+    std::vector<Event> heap_;
+    std::uint64_t      nextSeq_ = 0;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "Device.hpp"
+#include "Snapshot.hpp"
+#include <cctype>
+#include <cstdio>
+#include <string>
+
+class HomeDevice : public Device
+{
+public:
+    HomeDevice(int id, NetworkScope scope, const std::string& ip, std::string name)
+        : HomeDevice(id, scope, ipv4(ip), std::move(name)) {}
+
+    HomeDevice(int id, NetworkScope scope, IpAddress ip, std::string name)
+        : Device(id, scope, ip),
+          name_(std::move(name))
+    {
+        std::string lower = name_;
+        for (char &c : lower) c = static_cast<char>(std::tolower(c));
+
+        if (lower.find("desktop") != std::string::npos)
+            type_ = "Desktop PC";
+        else if (lower.find("laptop") != std::string::npos)
+            type_ = "Laptop";
+        else if (lower.find("phone") != std::string::npos)
+            type_ = "Smartphone";
+        else if (lower.find("television") != std::string::npos ||
+                 lower.find("tv") != std::string::npos)
+            type_ = "Smart TV";
+        else if (lower.find("fridge") != std::string::npos)
+            type_ = "Smart Fridge";
+        else if (lower.find("tablet") != std::string::npos)
+            type_ = "Tablet";
+        else
+            type_ = "Endpoint";
+
+        if (lower.find("john") != std::string::npos)
+            user_ = "John";
+        else
+            user_ = "Family";
+
+        char buf[18];
+        std::snprintf(buf, sizeof(buf), "02:00:00:00:%02X:%02X",
+                      (id >> 8) & 0xFF, id & 0xFF);
+        mac_ = buf;
+        publicIp_ = makeIpv4(203, 0, 113, 5);
+    }
+
+    const std::string& name()     const { return name_; }
+    const std::string& type()     const { return type_; }
+    const std::string& user()     const { return user_; }
+    const std::string& mac()      const { return mac_; }
+    IpAddress          publicIp() const { return publicIp_; }
+
+    void onPacketReceived(const Packet& pkt) override { (void)pkt; }
+
+    DeviceKind kind() const override { return DeviceKind::Home; }
+
+    void saveState(SnapshotWriter& out) const override
+    {
+        out.put(ip_);
+        out.put(publicIp_);
+        out.putString(name_);
+        out.putString(type_);
+        out.putString(user_);
+        out.putString(mac_);
+    }
+
+    void restoreState(SnapshotReader& in) override
+    {
+        in.get(ip_);
+        in.get(publicIp_);
+        name_ = in.getString();
+        type_ = in.getString();
+        user_ = in.getString();
+        mac_  = in.getString();
+    }
+
+    DeviceInfo info() const override
+    {
+        return DeviceInfo{
+            name_, user_, type_, formatIpv4(ip_), formatIpv4(publicIp_), mac_
+        };
+    }
+
+private:
+    std::string name_, type_, user_, mac_;
+    IpAddress   publicIp_;
+};
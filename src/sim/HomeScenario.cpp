@@ -0,0 +1,119 @@
+#include "HomeScenario.hpp"
+#include "HomeDevice.hpp"
+#include "RouterDevice.hpp"
+#include "Snapshot.hpp"
+#include <memory>
+#include <sstream>
+
+// what the demo home has always sent: a DNS query from one of the computers
+// every 3 s, a five-packet web burst every 5 s, a video chunk from the TV
+// every 0.4 s and a fridge check-in every 10 s
+static const char* const kHomeTraffic = R"(
+profile dns
+    clients  Desktop PC, Laptop, Smartphone
+    arrival  periodic 3
+    size     fixed 80
+    packet   udp dns 53
+    srcport  40000 +client
+end
+
+profile web
+    clients  Desktop PC, Laptop, Smartphone
+    arrival  periodic 5
+    burst    5
+    size     fixed 900
+    packet   tcp https 443
+    srcport  50000 +burst
+end
+
+profile video
+    clients  Smart TV
+    arrival  periodic 0.4
+    size     fixed 4000
+    packet   tcp https 443
+    srcport  60000
+end
+
+profile fridge
+    clients  Smart Fridge
+    arrival  periodic 10
+    size     fixed 200
+    packet   tcp https 443
+    srcport  55000
+end
+)";
+
+HomeScenario::HomeScenario(Network& net, Simulation& sim, std::uint32_t seed, int firstId)
+    : network_(net), firstId_(firstId), nextId_(firstId),
+      traffic_(net, sim, seed, nextPacketId_)
+{
+    std::istringstream in(kHomeTraffic);
+    std::vector<TrafficProfile> profiles;
+    std::string error;
+    parseTrafficProfiles(in, profiles, error); // built in, known good
+    setTraffic(profiles);
+}
+
+int HomeScenario::addHome(const std::string& ip, const std::string& name)
+{
+    int id = network_.addDevice(
+        std::make_unique<HomeDevice>(nextId_++, NetworkScope::Local, ip, name)
+    );
+    double bw   = 100.0;
+    double lat  = 5.0;
+    if (name.find("TV") != std::string::npos ||
+        name.find("Desktop") != std::string::npos ||
+        name.find("television") != std::string::npos) {
+        bw  = 1000.0;
+        lat = 1.0;
+    }
+    network_.addLink(routerId_, id, bw, lat);
+    return id;
+}
+
+void HomeScenario::build()
+{
+    routerId_ = network_.addDevice(
+        std::make_unique<RouterDevice>(nextId_++, NetworkScope::Local, "192.168.0.1")
+    );
+
+    addHome("192.168.0.10", "family-desktop");
+    addHome("192.168.0.11", "personal-laptop");
+    addHome("192.168.0.12", "johns-phone");
+    addHome("192.168.0.13", "family-tablet");
+    addHome("192.168.0.14", "family-television");
+    addHome("192.168.0.20", "smart-fridge");
+}
+
+void HomeScenario::setTraffic(const std::vector<TrafficProfile>& profiles)
+{
+    traffic_.clearProfiles();
+    for (const auto& p : profiles) traffic_.addProfile(p);
+}
+
+void HomeScenario::start()
+{
+    // clients are this home's devices only; other homes may share the network
+    std::vector<int> devices;
+    for (int id = firstId_; id < nextId_; ++id) devices.push_back(id);
+    traffic_.start(devices);
+}
+
+void HomeScenario::save(SnapshotWriter& out) const
+{
+    out.put(firstId_);
+    out.put(nextId_);
+    out.put(routerId_);
+    out.put(nextPacketId_);
+    traffic_.save(out);
+}
+
+bool HomeScenario::restore(SnapshotReader& in)
+{
+    in.get(firstId_);
+    in.get(nextId_);
+    in.get(routerId_);
+    in.get(nextPacketId_);
+    traffic_.restore(in);
+    return in.ok();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Network.hpp"
+#include "Simulation.hpp"
+#include "TrafficGenerator.hpp"
+#include <cstdint>
+#include <vector>
+
+// The demo home LAN: a router, six endpoints behind it, and the traffic
+// that runs against it: by default periodic DNS, web, video and fridge
+// profiles (kHomeTraffic), or whatever profiles the caller sets. Shared by
+// the GUI and the headless runner.
+class HomeScenario
+{
+public:
+    // device ids are handed out from firstId upwards; every home can share
+    // one seed, since its streams are also keyed by the device ids
+    HomeScenario(Network& net, Simulation& sim, std::uint32_t seed, int firstId = 0);
+
+    // add the devices and links
+    void build();
+    // replaces the built-in profiles; call before start()
+    void setTraffic(const std::vector<TrafficProfile>& profiles);
+    // start the traffic streams; the router answers on its own
+    void start();
+
+    // Ids, packet counter and traffic streams. restore() takes the place of
+    // build() and start() on a network and simulation restored from the
+    // same snapshot: it re-binds the traffic timers.
+    void save(SnapshotWriter& out) const;
+    bool restore(SnapshotReader& in);
+    // different random traffic from here on
+    void reseed(std::uint64_t seed) { traffic_.reseed(seed); }
+
+    int routerId() const { return routerId_; }
+    int nextFreeId() const { return nextId_; }
+    // by the traffic streams; the router's replies count as
+    // NetworkStats::packetsEmitted
+    std::uint64_t packetsGenerated() const { return nextPacketId_ - 1; }
+
+private:
+    int addHome(const std::string& ip, const std::string& name);
+
+    Network&    network_;
+
+    int firstId_       = 0;
+    int nextId_        = 0;
+    int routerId_      = -1;
+
+    std::uint64_t nextPacketId_ = 1;
+
+    TrafficGenerator traffic_;
+};
@@ -0,0 +1,286 @@
+#include "InFlightStore.hpp"
+#include "Snapshot.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+void InFlightStore::push(const Packet& pkt, int linkId, int fromNode, int toNode,
+                         double travelTime, double delay)
+{
+    double inv = travelTime > 0.0 ? 1.0 / travelTime : 1e30;
+    pushRow(pkt, linkId, fromNode, toNode,
+            delay > 0.0 ? static_cast<float>(-delay * inv) : 0.f, static_cast<float>(inv));
+}
+
+void InFlightStore::pushRow(const Packet& pkt, int linkId, int fromNode, int toNode,
+                            float progress, float invTravel)
+{
+    std::uint32_t h = packets_.acquire(pkt);
+
+    progress_.push_back(progress);
+    invTravel_.push_back(invTravel);
+    linkId_.push_back(linkId);
+    fromNode_.push_back(fromNode);
+    toNode_.push_back(toNode);
+    handle_.push_back(h);
+
+    ensureLink(linkId);
+    LinkIndex& link = links_[linkId];
+    linkSlot_.push_back(static_cast<std::uint32_t>(link.rows.size()));
+    link.rows.push_back(static_cast<std::uint32_t>(progress_.size() - 1));
+
+    std::vector<PortCount>& ports = link.ports;
+    auto it = std::lower_bound(ports.begin(), ports.end(), pkt.dstPort,
+                               [](const PortCount& pc, std::uint16_t port) { return pc.port < port; });
+    if (it != ports.end() && it->port == pkt.dstPort) ++it->packets;
+    else ports.insert(it, PortCount{ pkt.dstPort, 1 });
+
+    if (binning_) {
+        std::uint32_t base = binBase(linkId, fromNode, toNode, pkt.dstPort);
+        int b = binOf(progress_.back());
+        binBase_.push_back(base);
+        bin_.push_back(static_cast<std::uint8_t>(b));
+        ++bins_[base + b * kTrafficClasses];
+    }
+}
+
+static constexpr std::size_t kBinsPerLink = 2 * InFlightStore::kLinkBins * InFlightStore::kTrafficClasses;
+
+void InFlightStore::ensureLink(int linkId)
+{
+    if (static_cast<std::size_t>(linkId) < links_.size()) return;
+    links_.resize(linkId + 1);
+    if (binning_) bins_.resize(links_.size() * kBinsPerLink, 0);
+}
+
+const std::vector<std::uint32_t>& InFlightStore::rowsOnLink(int linkId) const
+{
+    static const std::vector<std::uint32_t> none;
+    if (linkId < 0 || static_cast<std::size_t>(linkId) >= links_.size()) return none;
+    return links_[linkId].rows;
+}
+
+const std::vector<InFlightStore::PortCount>& InFlightStore::portsOnLink(int linkId) const
+{
+    static const std::vector<PortCount> none;
+    if (linkId < 0 || static_cast<std::size_t>(linkId) >= links_.size()) return none;
+    return links_[linkId].ports;
+}
+
+std::uint32_t InFlightStore::binBase(int linkId, int fromNode, int toNode, std::uint16_t dstPort)
+{
+    int dir = fromNode < toNode ? 0 : 1;
+    return static_cast<std::uint32_t>(linkId * kBinsPerLink + dir * kLinkBins * kTrafficClasses +
+                                      trafficClass(dstPort));
+}
+
+const std::uint32_t* InFlightStore::linkBins(int linkId, int dir) const
+{
+    if (!binning_ || linkId < 0 || static_cast<std::size_t>(linkId) >= links_.size()) {
+        return nullptr;
+    }
+    return bins_.data() + (static_cast<std::size_t>(linkId) * 2 + dir) * kLinkBins * kTrafficClasses;
+}
+
+void InFlightStore::save(SnapshotWriter& out) const
+{
+    out.put<std::uint64_t>(size());
+    for (std::size_t i = 0; i < size(); ++i) {
+        out.put(packet(i));
+        out.put(linkId_[i]);
+        out.put(fromNode_[i]);
+        out.put(toNode_[i]);
+        out.put(progress_[i]);
+        out.put(invTravel_[i]);
+    }
+    std::uint64_t busy = 0;
+    for (const LinkIndex& link : links_) busy += !link.rows.empty();
+    out.put(busy);
+    for (std::size_t id = 0; id < links_.size(); ++id) {
+        if (links_[id].rows.empty()) continue;
+        out.put(static_cast<std::int32_t>(id));
+        out.putVector(links_[id].rows);
+    }
+}
+
+void InFlightStore::restore(SnapshotReader& in, const std::function<bool(int linkId)>& linkExists)
+{
+    const std::size_t n = in.getCount(sizeof(Packet));
+    for (std::size_t i = 0; i < n && in.ok(); ++i) {
+        const Packet pkt    = in.get<Packet>();
+        const int    linkId = in.get<int>();
+        const int    from   = in.get<int>();
+        const int    to     = in.get<int>();
+        const float  prog   = in.get<float>();
+        const float  inv    = in.get<float>();
+        if (linkId < 0 || !linkExists(linkId)) in.fail();
+        if (in.ok()) pushRow(pkt, linkId, from, to, prog, inv);
+    }
+
+    // each link's list in its saved order, which take() order depends on
+    const std::size_t busy = in.getCount(sizeof(std::int32_t));
+    std::vector<std::uint32_t> rows;
+    std::vector<char> listed(size(), 0);
+    for (std::size_t k = 0; k < busy && in.ok(); ++k) {
+        const std::int32_t id = in.get<std::int32_t>();
+        in.getVector(rows);
+        if (!in.ok()) break;
+        if (id < 0 || static_cast<std::size_t>(id) >= links_.size() ||
+            rows.size() != links_[id].rows.size()) {
+            in.fail();
+            break;
+        }
+        for (std::size_t slot = 0; slot < rows.size(); ++slot) {
+            if (rows[slot] >= size() || linkId_[rows[slot]] != id || listed[rows[slot]]) {
+                in.fail();
+                return;
+            }
+            listed[rows[slot]] = 1;
+            linkSlot_[rows[slot]] = static_cast<std::uint32_t>(slot);
+        }
+        links_[id].rows.swap(rows);
+    }
+}
+
+void InFlightStore::setBinning(bool on)
+{
+    binning_ = on;
+    binBase_.clear();
+    bin_.clear();
+    bins_.clear();
+    if (!on) return;
+
+    bins_.assign(links_.size() * kBinsPerLink, 0);
+    binBase_.reserve(size());
+    bin_.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i) {
+        std::uint32_t base = binBase(linkId_[i], fromNode_[i], toNode_[i], packet(i).dstPort);
+        int b = binOf(progress_[i]);
+        binBase_.push_back(base);
+        bin_.push_back(static_cast<std::uint8_t>(b));
+        ++bins_[base + b * kTrafficClasses];
+    }
+}
+
+void InFlightStore::updateBins()
+{
+    // most steps move a packet less than a slice, so this mostly compares
+    for (std::size_t i = 0; i < progress_.size(); ++i) {
+        int b = binOf(progress_[i]);
+        if (b == bin_[i]) continue;
+        --bins_[binBase_[i] + bin_[i] * kTrafficClasses];
+        ++bins_[binBase_[i] + b * kTrafficClasses];
+        bin_[i] = static_cast<std::uint8_t>(b);
+    }
+}
+
+Packet InFlightStore::take(std::size_t i)
+{
+    unlinkRow(i);
+    std::uint32_t h = handle_[i];
+    Packet pkt = packets_[h];
+    packets_.release(h);
+
+    const std::size_t last = progress_.size() - 1;
+    if (last != i) {
+        // the last row moves into i; repoint its link's list entry
+        links_[linkId_[last]].rows[linkSlot_[last]] = static_cast<std::uint32_t>(i);
+        linkSlot_[i] = linkSlot_[last];
+    }
+    linkSlot_.pop_back();
+
+    if (binning_) {
+        --bins_[binBase_[i] + bin_[i] * kTrafficClasses];
+        binBase_[i] = binBase_[last];
+        bin_[i]     = bin_[last];
+        binBase_.pop_back();
+        bin_.pop_back();
+    }
+
+    progress_[i]  = progress_[last];
+    invTravel_[i] = invTravel_[last];
+    linkId_[i]    = linkId_[last];
+    fromNode_[i]  = fromNode_[last];
+    toNode_[i]    = toNode_[last];
+    handle_[i]    = handle_[last];
+
+    progress_.pop_back();
+    invTravel_.pop_back();
+    linkId_.pop_back();
+    fromNode_.pop_back();
+    toNode_.pop_back();
+    handle_.pop_back();
+    return pkt;
+}
+
+void InFlightStore::unlinkRow(std::size_t i)
+{
+    LinkIndex& link = links_[linkId_[i]];
+    std::vector<std::uint32_t>& rows = link.rows;
+    std::uint32_t slot  = linkSlot_[i];
+    std::uint32_t moved = rows.back();
+    rows[slot] = moved;
+    linkSlot_[moved] = slot;
+    rows.pop_back();
+
+    std::vector<PortCount>& ports = link.ports;
+    const std::uint16_t port = packets_[handle_[i]].dstPort;
+    auto it = std::lower_bound(ports.begin(), ports.end(), port,
+                               [](const PortCount& pc, std::uint16_t p) { return pc.port < p; });
+    if (--it->packets == 0) ports.erase(it);
+}
+
+// emit the indices of the set bits in `mask`, offset by `base`
+static inline std::size_t appendArrivals(unsigned mask, std::uint32_t base,
+                                         std::uint32_t* out)
+{
+    std::size_t n = 0;
+    while (mask) {
+        unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+        out[n++] = base + bit;
+        mask &= mask - 1;
+    }
+    return n;
+}
+
+std::size_t InFlightStore::advance(double dt, std::uint32_t* arrived)
+{
+    const std::size_t n = progress_.size();
+    float*       p   = progress_.data();
+    const float* inv = invTravel_.data();
+    const float  fdt = static_cast<float>(dt);
+    std::size_t  i   = 0;
+    std::size_t  count = 0;
+
+#if defined(__AVX2__)
+    const __m256 vdt  = _mm256_set1_ps(fdt);
+    const __m256 vone = _mm256_set1_ps(1.f);
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(p + i);
+        v = _mm256_add_ps(v, _mm256_mul_ps(vdt, _mm256_loadu_ps(inv + i)));
+        _mm256_storeu_ps(p + i, v);
+        unsigned mask = static_cast<unsigned>(
+            _mm256_movemask_ps(_mm256_cmp_ps(v, vone, _CMP_GE_OQ)));
+        if (mask) count += appendArrivals(mask, static_cast<std::uint32_t>(i), arrived + count);
+    }
+#elif defined(__SSE2__)
+    const __m128 vdt  = _mm_set1_ps(fdt);
+    const __m128 vone = _mm_set1_ps(1.f);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(p + i);
+        v = _mm_add_ps(v, _mm_mul_ps(vdt, _mm_loadu_ps(inv + i)));
+        _mm_storeu_ps(p + i, v);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmpge_ps(v, vone)));
+        if (mask) count += appendArrivals(mask, static_cast<std::uint32_t>(i), arrived + count);
+    }
+#endif
+
+    // scalar tail (and the whole array without SIMD)
+    for (; i < n; ++i) {
+        p[i] += fdt * inv[i];
+        if (p[i] >= 1.f) arrived[count++] = static_cast<std::uint32_t>(i);
+    }
+    if (binning_) updateBins();
+    return count;
+}
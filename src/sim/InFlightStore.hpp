@@ -0,0 +1,122 @@
+#pragma once
+#include "Device.hpp"
+#include "Pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Packets currently travelling along links, stored column-wise so the
+// per-step advance touches only the progress and inverse travel time arrays.
+// Row order is not stable: removal swaps the last row into the hole.
+// Each link also keeps the list of its rows and a count per destination
+// port, updated on push and take, so looking at one link costs only the
+// packets on it.
+class InFlightStore
+{
+public:
+    // Level-of-detail occupancy. With binning on, the store counts, per
+    // link and direction, how many packets sit in each of kLinkBins equal
+    // slices along the link, split by traffic class. Counts change only when
+    // a packet is pushed, taken, or crosses a slice boundary, so a view can
+    // draw a busy link without walking its packets.
+    static constexpr int kLinkBins = 16;
+    enum TrafficClass { Https, Dns, OtherTraffic, kTrafficClasses };
+    static int trafficClass(std::uint16_t dstPort)
+    {
+        return dstPort == 443 ? Https : dstPort == 53 ? Dns : OtherTraffic;
+    }
+
+    std::size_t size()  const { return progress_.size(); }
+    bool        empty() const { return progress_.empty(); }
+
+    // delay > 0 holds the packet at fromNode (negative progress) that long
+    // before it starts to move
+    void push(const Packet& pkt, int linkId, int fromNode, int toNode,
+              double travelTime, double delay = 0.0);
+
+    // progress += dt / travelTime for every row; rows that reach the far end
+    // are written to `arrived` (room for size() entries) in ascending order.
+    // Returns how many arrived.
+    std::size_t advance(double dt, std::uint32_t* arrived);
+
+    // swap-remove row i and return its packet
+    Packet take(std::size_t i);
+    void   removeAt(std::size_t i) { (void)take(i); }
+
+    // 0 @ fromNode, 1 @ toNode; negative while still queued at fromNode
+    float         progress(std::size_t i) const { return progress_[i]; }
+    float         invTravel(std::size_t i) const { return invTravel_[i]; }
+    int           linkId(std::size_t i)   const { return linkId_[i]; }
+    int           fromNode(std::size_t i) const { return fromNode_[i]; }
+    int           toNode(std::size_t i)   const { return toNode_[i]; }
+    const Packet& packet(std::size_t i)   const { return packets_[handle_[i]]; }
+
+    struct PortCount
+    {
+        std::uint16_t port;
+        std::uint32_t packets;
+    };
+    // rows on a link, in no particular order; invalidated by push and take
+    const std::vector<std::uint32_t>& rowsOnLink(int linkId) const;
+    // destination ports with at least one packet on the link, by port number
+    const std::vector<PortCount>& portsOnLink(int linkId) const;
+    std::uint32_t linkPackets(int linkId) const
+    {
+        return static_cast<std::uint32_t>(rowsOnLink(linkId).size());
+    }
+
+    // rows, with their order and each link's row order, so a restored store
+    // advances and delivers exactly as the saved one would; restore()
+    // expects an empty store, and fails the reader on a row whose link
+    // `linkExists` rejects or a row listed twice
+    void save(SnapshotWriter& out) const;
+    void restore(SnapshotReader& in, const std::function<bool(int linkId)>& linkExists);
+
+    // counts are rebuilt from the current rows when binning is turned on
+    void setBinning(bool on);
+    bool binning() const { return binning_; }
+    // counts[bin * kTrafficClasses + class] for packets heading away from
+    // the lower node id (dir 0) or toward it (dir 1), bins numbered from
+    // each packet's sender; nullptr if the link has never carried any
+    const std::uint32_t* linkBins(int linkId, int dir) const;
+
+private:
+    void pushRow(const Packet& pkt, int linkId, int fromNode, int toNode,
+                 float progress, float invTravel);
+    static int binOf(float progress)
+    {
+        return progress <= 0.f ? 0 : std::min(static_cast<int>(progress * kLinkBins), kLinkBins - 1);
+    }
+    // first histogram entry (bin 0) for a packet's link, direction and class
+    std::uint32_t binBase(int linkId, int fromNode, int toNode, std::uint16_t dstPort);
+    void          updateBins();
+    void          ensureLink(int linkId);
+    void          unlinkRow(std::size_t i);
+
+    // columns, one entry per in-flight packet
+    std::vector<float>         progress_;
+    std::vector<float>         invTravel_;
+    std::vector<int>           linkId_;
+    std::vector<int>           fromNode_;
+    std::vector<int>           toNode_;
+    std::vector<std::uint32_t> handle_;
+    std::vector<std::uint32_t> linkSlot_; // position of the row in its link's list
+
+    // per link id; both lists side by side so a push touches one entry
+    struct LinkIndex
+    {
+        std::vector<std::uint32_t> rows;
+        std::vector<PortCount>     ports;
+    };
+    std::vector<LinkIndex> links_;
+
+    // packet bodies, addressed by handle
+    SlabPool<Packet>           packets_;
+
+    // binning columns (empty while off) and the per-link histograms
+    bool                       binning_ = false;
+    std::vector<std::uint32_t> binBase_;
+    std::vector<std::uint8_t>  bin_;
+    std::vector<std::uint32_t> bins_;        // [link][dir][bin][class]
+};
@@ -1,15 +1,16 @@
 #pragma once
 #include "Device.hpp"
+#include "Random.hpp"
+#include "Snapshot.hpp"
 #include <iostream>
-#include <random>
 
 class IoTDevice : public Device
 {
 public:
-    IoTDevice(int id, NetworkScope scope)
+    // send times are keyed by (seed, id), like every other stream
+    IoTDevice(int id, NetworkScope scope, std::uint64_t seed = 0)
         : Device(id, scope),
-        rng_(std::random_device{}()),
-        distInterval_(0.5, 2.0)
+        rng_(seed, static_cast<std::uint64_t>(id), 0)
     {
         scheduleNextSend(0.0);
     }
@@ -29,6 +30,8 @@ public:
                       << " at t=" << now << "s\n";
             // eventually pass into the simulation
             scheduleNextSend(now);
+        } else {
+            wakeAt(nextSendTime_);
         }
     }
     void onPacketReceived(const Packet& pkt) override
@@ -36,16 +39,38 @@ public:
         std::cout << "[IoTDevice " << id_ << "] received packet "
                   << pkt.id << " from " << pkt.srcNodeId << "\n";
     }
+    DeviceInfo info() const override
+    {
+        return DeviceInfo{ "iot-device", "", "IoT", "", "", "" };
+    }
+
+    DeviceKind kind() const override { return DeviceKind::IoT; }
+
+    void saveState(SnapshotWriter& out) const override
+    {
+        out.put(nextSendTime_);
+        out.put(nextPacketId_);
+        out.put(rng_);
+    }
+
+    void restoreState(SnapshotReader& in) override
+    {
+        in.get(nextSendTime_);
+        in.get(nextPacketId_);
+        in.get(rng_);
+        wakeAt(nextSendTime_);
+    }
+
 private:
     void scheduleNextSend(double now)
     {
-        double interval = distInterval_(rng_);
+        double interval = 0.5 + 1.5 * rng_.uniform();
         nextSendTime_ = now + interval;
+        wakeAt(nextSendTime_);
     }
     double nextSendTime_ = 0.0;
     std::uint64_t nextPacketId_ = 0;
 
-    std::mt19937 rng_;
-    std::uniform_real_distribution<double> distInterval_;
+    CounterRng rng_;
 
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "IpAddress.hpp"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+bool parseIpv4(const std::string& text, IpAddress& out)
+{
+    IpAddress value = 0;
+    int parts = 0;
+    std::size_t i = 0;
+    while (parts < 4) {
+        if (i >= text.size() || text[i] < '0' || text[i] > '9') return false;
+        unsigned octet = 0;
+        std::size_t digits = 0;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+            octet = octet * 10 + static_cast<unsigned>(text[i] - '0');
+            if (++digits > 3 || octet > 255) return false;
+            ++i;
+        }
+        value = (value << 8) | octet;
+        if (++parts < 4) {
+            if (i >= text.size() || text[i] != '.') return false;
+            ++i;
+        }
+    }
+    if (i != text.size()) return false;
+    out = value;
+    return true;
+}
+
+IpAddress ipv4(const std::string& text)
+{
+    IpAddress addr = 0;
+    return parseIpv4(text, addr) ? addr : 0;
+}
+
+std::string formatIpv4(IpAddress addr)
+{
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
+                  (addr >> 24) & 0xFF, (addr >> 16) & 0xFF,
+                  (addr >> 8) & 0xFF, addr & 0xFF);
+    return buf;
+}
+
+bool parseIpv6(const std::string& text, Ipv6Address& out)
+{
+    std::uint16_t head[8], tail[8];
+    int nHead = 0, nTail = 0;
+    bool compressed = false;
+
+    std::size_t i = 0;
+    if (text.compare(0, 2, "::") == 0) {
+        compressed = true;
+        i = 2;
+    }
+    while (i < text.size()) {
+        std::size_t end = i;
+        while (end < text.size() && std::isxdigit(static_cast<unsigned char>(text[end]))) ++end;
+        if (end == i || end - i > 4) return false;
+
+        auto group = static_cast<std::uint16_t>(std::strtoul(text.substr(i, end - i).c_str(), nullptr, 16));
+        if (nHead + nTail >= 8) return false;
+        if (compressed) tail[nTail++] = group;
+        else            head[nHead++] = group;
+
+        i = end;
+        if (i == text.size()) break;
+        if (text[i] != ':') return false;
+        if (i + 1 < text.size() && text[i + 1] == ':') {
+            if (compressed) return false; // only one "::" allowed
+            compressed = true;
+            i += 2;
+        } else {
+            ++i;
+            if (i == text.size()) return false; // trailing single ':'
+        }
+    }
+
+    if (compressed ? nHead + nTail > 7 : nHead != 8) return false;
+
+    std::uint16_t groups[8] = {};
+    for (int g = 0; g < nHead; ++g) groups[g] = head[g];
+    for (int g = 0; g < nTail; ++g) groups[8 - nTail + g] = tail[g];
+    for (int g = 0; g < 8; ++g) {
+        out[2 * g]     = static_cast<std::uint8_t>(groups[g] >> 8);
+        out[2 * g + 1] = static_cast<std::uint8_t>(groups[g] & 0xFF);
+    }
+    return true;
+}
+
+std::string formatIpv6(const Ipv6Address& addr)
+{
+    std::uint16_t groups[8];
+    for (int g = 0; g < 8; ++g) {
+        groups[g] = static_cast<std::uint16_t>((addr[2 * g] << 8) | addr[2 * g + 1]);
+    }
+
+    // longest run of two or more zero groups gets "::"
+    int bestStart = -1, bestLen = 1;
+    for (int g = 0; g < 8;) {
+        if (groups[g] != 0) { ++g; continue; }
+        int start = g;
+        while (g < 8 && groups[g] == 0) ++g;
+        if (g - start > bestLen) { bestStart = start; bestLen = g - start; }
+    }
+
+    std::string out;
+    char buf[8];
+    for (int g = 0; g < 8; ++g) {
+        if (g == bestStart) {
+            out += "::";
+            g += bestLen - 1;
+            continue;
+        }
+        if (!out.empty() && out.back() != ':') out += ':';
+        std::snprintf(buf, sizeof(buf), "%x", groups[g]);
+        out += buf;
+    }
+    return out;
+}
+
+std::size_t Ipv6Table::Hash::operator()(const Ipv6Address& a) const
+{
+    // FNV-1a over the 16 bytes
+    std::uint64_t h = 1469598103934665603ull;
+    for (std::uint8_t b : a) {
+        h ^= b;
+        h *= 1099511628211ull;
+    }
+    return static_cast<std::size_t>(h);
+}
+
+IpAddress Ipv6Table::intern(const Ipv6Address& addr)
+{
+    auto it = index_.find(addr);
+    if (it != index_.end()) return it->second;
+
+    IpAddress handle = static_cast<IpAddress>(addrs_.size());
+    addrs_.push_back(addr);
+    index_.emplace(addr, handle);
+    return handle;
+}
+
+Ipv6Table& ipv6Table()
+{
+    static Ipv6Table table;
+    return table;
+}
+
+std::string formatAddress(IpAddress addr, AddressFamily family)
+{
+    if (family == AddressFamily::IPv6) return formatIpv6(ipv6Table().lookup(addr));
+    return formatIpv4(addr);
+}
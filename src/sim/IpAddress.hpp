@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Packets carry addresses as 32-bit values. For IPv4 the value is the address
+// itself (host byte order); for IPv6 it is a handle into Ipv6Table, which
+// interns the 128-bit addresses so Packet stays inside one cache line.
+using IpAddress   = std::uint32_t;
+using Ipv6Address = std::array<std::uint8_t, 16>;
+
+enum class AddressFamily : std::uint8_t
+{
+    IPv4,
+    IPv6
+};
+
+constexpr IpAddress makeIpv4(std::uint8_t a, std::uint8_t b, std::uint8_t c, std::uint8_t d)
+{
+    return (IpAddress(a) << 24) | (IpAddress(b) << 16) | (IpAddress(c) << 8) | IpAddress(d);
+}
+
+// dotted quad <-> value; parse returns false on malformed input
+bool        parseIpv4(const std::string& text, IpAddress& out);
+IpAddress   ipv4(const std::string& text); // 0.0.0.0 on malformed input
+std::string formatIpv4(IpAddress addr);
+
+// RFC 4291 text form, with "::" compression on output
+bool        parseIpv6(const std::string& text, Ipv6Address& out);
+std::string formatIpv6(const Ipv6Address& addr);
+
+class Ipv6Table
+{
+public:
+    IpAddress          intern(const Ipv6Address& addr);
+    const Ipv6Address& lookup(IpAddress handle) const { return addrs_[handle]; }
+    std::size_t        size() const { return addrs_.size(); }
+
+private:
+    struct Hash
+    {
+        std::size_t operator()(const Ipv6Address& a) const;
+    };
+
+    std::vector<Ipv6Address>                         addrs_;
+    std::unordered_map<Ipv6Address, IpAddress, Hash> index_;
+};
+
+// process-wide table; intern during setup, lookups are read-only afterwards
+Ipv6Table& ipv6Table();
+
+// format either family for display or export
+std::string formatAddress(IpAddress addr, AddressFamily family);
@@ -1,14 +1,131 @@
 #include "Network.hpp"
+#include "Profiler.hpp"
+#include "Snapshot.hpp"
 #include <algorithm>
+#include <new>
+
+void Network::ensureNode(int id)
+{
+    if (static_cast<std::size_t>(id) >= deviceSlot_.size()) {
+        deviceSlot_.resize(id + 1, -1);
+        adjacency_.resize(id + 1);
+    }
+}
+
+void Network::reserve(std::size_t nodeIds, std::size_t devices, std::size_t links)
+{
+    if (nodeIds > 0) ensureNode(static_cast<int>(nodeIds - 1));
+    devices_.reserve(devices_.size() + devices);
+    links_.reserve(links_.size() + links);
+    linkSlot_.reserve(linkSlot_.size() + links);
+}
+
+void Network::reserveLinksOf(int nodeId, std::size_t n)
+{
+    if (nodeId < 0) return;
+    ensureNode(nodeId);
+    adjacency_[nodeId].reserve(adjacency_[nodeId].size() + n);
+}
 
 int Network::addDevice(std::unique_ptr<Device> dev) 
 {
     int id = dev->id();
+    if (id < 0) return -1;
+    ensureNode(id);
+    if (deviceSlot_[id] != -1) return -1; // id already taken
+
+    deviceSlot_[id] = static_cast<int>(devices_.size());
+    attach(*dev);
     devices_.push_back(std::move(dev));
+    ++topologyVersion_;
     return id;
 }
 
-int Network::addLink(int a, int b, double bandwidthMbps, double latencyMs) 
+void Network::attach(Device& dev)
+{
+    dev.network_ = this;
+    if (dev.wakeup_ != Device::kNever) queueWakeup(dev.id(), dev.wakeup_);
+}
+
+// heap order for wakeups_: std::push_heap keeps the greatest on top, so
+// "greater" here is the earlier (time, id)
+bool Network::wakesLater(const Wakeup& a, const Wakeup& b)
+{
+    if (a.time != b.time) return a.time > b.time;
+    return a.deviceId > b.deviceId;
+}
+
+void Network::queueWakeup(int deviceId, double at)
+{
+    wakeups_.push_back(Wakeup{ at, deviceId });
+    std::push_heap(wakeups_.begin(), wakeups_.end(), wakesLater);
+}
+
+void Device::wakeAt(double at)
+{
+    wakeup_ = at;
+    if (network_ && at != kNever) network_->queueWakeup(id_, at);
+}
+
+void Device::send(const Packet& pkt, double delay)
+{
+    if (!network_) return;
+    network_->outbox_.push_back(Network::Outgoing{ pkt, id_, -1, -1, delay });
+    ++network_->stats_.packetsEmitted;
+}
+
+std::vector<Network::Outgoing>& Network::routeOutbox()
+{
+    std::size_t kept = 0;
+    for (Outgoing& out : outbox_) {
+        const int lid = routing_.nextLink(out.fromNode, out.pkt.dstNodeId);
+        const Link* link = getLink(lid);
+        if (!link) {
+            ++stats_.packetsDropped;
+            NETSIM_COUNT(PacketsDropped, 1);
+            continue;
+        }
+        out.nextHop = link->nodeA == out.fromNode ? link->nodeB : link->nodeA;
+        out.linkId  = lid;
+        outbox_[kept++] = out;
+    }
+    outbox_.resize(kept);
+    return outbox_;
+}
+
+double Network::nextWakeup()
+{
+    while (!wakeups_.empty()) {
+        const Wakeup& w = wakeups_.front();
+        const Device* dev = getDevice(w.deviceId);
+        if (dev && dev->wakeup_ == w.time) return w.time;
+        std::pop_heap(wakeups_.begin(), wakeups_.end(), wakesLater);
+        wakeups_.pop_back();
+    }
+    return Device::kNever;
+}
+
+void Network::tickDevices(double now)
+{
+    // take the due ones off first, so a device re-arming from its tick
+    // cannot keep this loop going
+    dueDevices_.clear();
+    while (!wakeups_.empty() && wakeups_.front().time <= now) {
+        std::pop_heap(wakeups_.begin(), wakeups_.end(), wakesLater);
+        const Wakeup w = wakeups_.back();
+        wakeups_.pop_back();
+        Device* dev = getDevice(w.deviceId);
+        if (!dev || dev->wakeup_ != w.time) continue; // removed or superseded
+        dev->wakeup_ = Device::kNever;
+        dueDevices_.push_back(w.deviceId);
+    }
+    for (int id : dueDevices_) {
+        // looked up again: an earlier tick may have removed it
+        if (Device* dev = getDevice(id)) dev->tick(now);
+    }
+}
+
+int Network::insertLink(int a, int b, double bandwidthMbps, double latencyMs, bool remote)
 {
     Link link;
     link.id            = nextLinkId_++;
@@ -17,30 +134,173 @@ int Network::addLink(int a, int b, double bandwidthMbps, double latencyMs)
     link.bandwidthMbps = bandwidthMbps;
     link.latencyMs     = latencyMs;
     link.currentLoad   = 0.0;
+    link.remote        = remote;
+    link.bufferBytes   = defaultBufferBytes_;
+
+    linkSlot_.push_back(static_cast<int>(links_.size()));
+    adjacency_[a].push_back(link.id);
+    if (b != a) adjacency_[b].push_back(link.id);
 
     links_.push_back(link);
+    ++topologyVersion_;
+    routing_.onLinkAdded(links_.back());
     return link.id;
 }
 
-Device* Network::getDevice(int id) 
+int Network::addLink(int a, int b, double bandwidthMbps, double latencyMs) 
+{
+    if (!getDevice(a) || !getDevice(b)) return -1;
+    return insertLink(a, b, bandwidthMbps, latencyMs, false);
+}
+
+int Network::addRemoteLink(int local, int remote, double bandwidthMbps, double latencyMs)
+{
+    if (!getDevice(local) || remote < 0 || getDevice(remote)) return -1;
+    // the remote end gets an adjacency entry but no device slot
+    ensureNode(remote);
+    return insertLink(local, remote, bandwidthMbps, latencyMs, true);
+}
+
+void Network::eraseId(std::vector<int>& ids, int id)
+{
+    auto it = std::find(ids.begin(), ids.end(), id);
+    if (it == ids.end()) return;
+    *it = ids.back();
+    ids.pop_back();
+}
+
+void Network::dropPacketsOn(int linkId)
 {
-    for (auto& dev : devices_) {
-        if (dev->id() == id) return dev.get();
+    // the link's row list shrinks as its rows are taken
+    const std::vector<std::uint32_t>& rows = inFlight_.rowsOnLink(linkId);
+    while (!rows.empty()) {
+        inFlight_.removeAt(rows.back());
+        ++stats_.packetsDropped;
+        NETSIM_COUNT(PacketsDropped, 1);
+    }
+    // nothing is left to transmit, so neither is any queue behind it
+    if (Link* link = getLink(linkId)) {
+        for (LinkDirection& d : link->dir) {
+            d.busyUntil   = 0.0;
+            d.queuedBytes = 0;
+            d.backlog.clear();
+        }
     }
-    return nullptr;
 }
 
-const Device* Network::getDevice(int id) const 
+bool Network::removeLink(int id)
 {
-    for (const auto& dev : devices_) {
-        if (dev->id() == id) return dev.get();
+    if (!getLink(id)) return false;
+
+    int slot = linkSlot_[id];
+    Link removed = links_[slot];
+    eraseId(adjacency_[removed.nodeA], id);
+    eraseId(adjacency_[removed.nodeB], id);
+    dropPacketsOn(id);
+
+    // swap-remove, then repoint the link that moved into the hole
+    links_[slot] = std::move(links_.back());
+    links_.pop_back();
+    if (slot < static_cast<int>(links_.size())) linkSlot_[links_[slot].id] = slot;
+    linkSlot_[id] = -1;
+    ++topologyVersion_;
+
+    routing_.onLinkRemoved(removed);
+    return true;
+}
+
+bool Network::setLinkUp(int id, bool up)
+{
+    Link* link = getLink(id);
+    if (!link) return false;
+    if (link->up == up) return true;
+
+    link->up = up;
+    ++topologyVersion_;
+    if (up) {
+        routing_.onLinkAdded(*link);
+    } else {
+        dropPacketsOn(id);
+        link->currentLoad = 0.0;
+        routing_.onLinkRemoved(*link);
     }
-    return nullptr;
+    return true;
+}
+
+std::unique_ptr<Device> Network::releaseDevice(int id)
+{
+    if (!getDevice(id)) return nullptr;
+
+    while (!adjacency_[id].empty()) {
+        removeLink(adjacency_[id].back());
+    }
+
+    int slot = deviceSlot_[id];
+    std::unique_ptr<Device> dev = std::move(devices_[slot]);
+    dev->network_ = nullptr; // keeps its wakeup for whoever adds it next
+    devices_[slot] = std::move(devices_.back());
+    devices_.pop_back();
+    if (slot < static_cast<int>(devices_.size())) deviceSlot_[devices_[slot]->id()] = slot;
+    deviceSlot_[id] = -1;
+    ++topologyVersion_;
+    routing_.onNodeRemoved(id);
+    return dev;
+}
+
+bool Network::removeDevice(int id)
+{
+    return releaseDevice(id) != nullptr;
+}
+
+Device* Network::getDevice(int id) 
+{
+    if (id < 0 || static_cast<std::size_t>(id) >= deviceSlot_.size()) return nullptr;
+    int slot = deviceSlot_[id];
+    return slot == -1 ? nullptr : devices_[slot].get();
+}
+
+const Device* Network::getDevice(int id) const 
+{
+    if (id < 0 || static_cast<std::size_t>(id) >= deviceSlot_.size()) return nullptr;
+    int slot = deviceSlot_[id];
+    return slot == -1 ? nullptr : devices_[slot].get();
+}
+
+Link* Network::getLink(int id)
+{
+    if (id < 0 || static_cast<std::size_t>(id) >= linkSlot_.size()) return nullptr;
+    int slot = linkSlot_[id];
+    return slot == -1 ? nullptr : &links_[slot];
+}
+
+const Link* Network::getLink(int id) const
+{
+    if (id < 0 || static_cast<std::size_t>(id) >= linkSlot_.size()) return nullptr;
+    int slot = linkSlot_[id];
+    return slot == -1 ? nullptr : &links_[slot];
+}
+
+const std::vector<int>& Network::linksOf(int nodeId) const
+{
+    static const std::vector<int> none;
+    if (nodeId < 0 || static_cast<std::size_t>(nodeId) >= adjacency_.size()) return none;
+    return adjacency_[nodeId];
+}
+
+Link* Network::findLink(int a, int b)
+{
+    return const_cast<Link*>(static_cast<const Network*>(this)->findLink(a, b));
 }
 
 const Link* Network::findLink(int a, int b) const 
 {
-    for (const auto& link : links_) {
+    // walk the endpoint with fewer links: a host behind a router has one
+    const std::vector<int>& la = linksOf(a);
+    const std::vector<int>& lb = linksOf(b);
+    const std::vector<int>& ids = la.size() <= lb.size() ? la : lb;
+
+    for (int lid : ids) {
+        const Link& link = links_[linkSlot_[lid]];
         if ((link.nodeA == a && link.nodeB == b) ||
             (link.nodeA == b && link.nodeB == a)) {
             return &link;
@@ -49,43 +309,317 @@ const Link* Network::findLink(int a, int b) const
     return nullptr;
 }
 
+bool Network::setLinkBuffer(int linkId, std::uint32_t bytes)
+{
+    Link* link = getLink(linkId);
+    if (!link) return false;
+    link->bufferBytes = bytes;
+    return true;
+}
+
+void Network::setTravelTimeScale(double scale, double minSeconds)
+{
+    travelScale_ = scale;
+    minTravel_   = minSeconds;
+}
+
 void Network::spawnPacketOnLink(const Packet& pkt, int fromNode, int toNode) 
 {
-    const Link* link = findLink(fromNode, toNode);
-    if (!link) return;
+    Link* link = findLink(fromNode, toNode);
+    if (link && !link->up) {
+        // a parallel link may still be up
+        for (int lid : linksOf(fromNode)) {
+            Link& l = links_[linkSlot_[lid]];
+            if (l.up && (l.nodeA == toNode || l.nodeB == toNode)) {
+                link = &l;
+                break;
+            }
+        }
+    }
+    spawnOn(link, pkt, fromNode, toNode);
+}
+
+void Network::transmit(const Packet& pkt, int linkId, int fromNode, int toNode)
+{
+    Link* link = getLink(linkId);
+    if (!link || !link->up) {
+        spawnPacketOnLink(pkt, fromNode, toNode);
+        return;
+    }
+    spawnOn(link, pkt, fromNode, toNode);
+}
+
+void Network::spawnOn(Link* link, const Packet& pkt, int fromNode, int toNode)
+{
+    if (!link || !link->up || (link->remote && !remoteSink_)) {
+        ++stats_.packetsDropped;
+        NETSIM_COUNT(PacketsDropped, 1);
+        return;
+    }
+
+    LinkDirection& dir = link->dir[fromNode == link->nodeA ? 0 : 1];
+    const double now = clock_;
+
+    // packets that finished serialising have left the buffer
+    while (!dir.backlog.empty() && dir.backlog.front().txEnd <= now) {
+        dir.queuedBytes -= dir.backlog.front().bytes;
+        dir.backlog.pop_front();
+    }
+    if (link->bufferBytes != 0 && dir.queuedBytes + pkt.sizeBytes > link->bufferBytes) {
+        ++dir.tailDrops;
+        ++stats_.tailDrops;
+        ++stats_.packetsDropped;
+        NETSIM_COUNT(PacketsDropped, 1);
+        return;
+    }
+
+    double bits    = static_cast<double>(pkt.sizeBytes) * 8.0;
+    double bwbps   = link->bandwidthMbps * 1'000'000.0;
+    double serTime = bits / bwbps;
+
+    double txStart = std::max(now, dir.busyUntil);
+    double txEnd   = txStart + serTime;
+    dir.busyUntil  = txEnd;
+    dir.backlog.push_back(LinkDirection::Pending{ txEnd, pkt.sizeBytes });
+    dir.queuedBytes += pkt.sizeBytes;
+    ++dir.txPackets;
+    dir.txBytes += pkt.sizeBytes;
+    ++stats_.packetsSent;
+    NETSIM_COUNT(PacketsSpawned, 1);
+    if (captureTap_) captureTap_(pkt, link->id, fromNode, toNode, txStart);
+
+    double wait   = (txStart - now) * travelScale_;
+    double flight = std::max((serTime + link->latencyMs / 1000.0) * travelScale_, minTravel_);
 
-    InFlightPacket f;
-    f.pkt      = pkt;
-    f.linkId   = link->id;
-    f.fromNode = fromNode;
-    f.toNode   = toNode;
-    f.t        = 0.0;
+    if (link->remote) {
+        remoteSink_(pkt, fromNode, toNode, wait + flight);
+        return;
+    }
+
+    // progress columns lag the clock until the next updatePackets; start
+    // the packet that much further back so it still arrives on time
+    link->currentLoad += pkt.sizeBytes;
+    inFlight_.push(pkt, link->id, fromNode, toNode, flight, wait + (now - advancedTo_));
+}
 
-    double latencySec = link->latencyMs / 1000.0;
-    double bits       = static_cast<double>(pkt.sizeBytes) * 8.0;
-    double bwbps      = link->bandwidthMbps * 1'000'000.0;
-    double serTime    = bits / bwbps;
+void Network::sendPacket(const Packet& pkt, int fromNode)
+{
+    // the link the path takes, not just any link to the next hop: with
+    // parallel links, the first one found may be down
+    Link* link = getLink(routing_.nextLink(fromNode, pkt.dstNodeId));
+    if (!link) {
+        ++stats_.packetsDropped;
+        NETSIM_COUNT(PacketsDropped, 1);
+        return;
+    }
+    spawnOn(link, pkt, fromNode, link->nodeA == fromNode ? link->nodeB : link->nodeA);
+}
 
-    double physicalTime = latencySec + serTime;
+void Network::deliver(const Packet& pkt, int toNode)
+{
+    if (pkt.dstNodeId >= 0 && pkt.dstNodeId != toNode) {
+        ++stats_.packetsForwarded;
+        sendPacket(pkt, toNode);
+        return;
+    }
 
-    // visual hack
-    f.travelTime = physicalTime * 50.0;     // exaggerate
-    if (f.travelTime < 0.5) f.travelTime = 0.5;
+    ++stats_.packetsDelivered;
+    NETSIM_COUNT(PacketsDelivered, 1);
+    stats_.bytesDelivered += pkt.sizeBytes;
 
-    inFlight_.push_back(f);
+    Device* dst = getDevice(toNode);
+    if (dst) dst->onPacketReceived(pkt);
 }
 
 void Network::updatePackets(double dt) 
 {
-    for (auto it = inFlight_.begin(); it != inFlight_.end();) {
-        it->t += dt / it->travelTime;
+    NETSIM_PROFILE_SCOPE(PacketMove);
+    advancedTo_ += dt;
+    if (clock_ < advancedTo_) clock_ = advancedTo_;
 
-        if (it->t >= 1.0) {
-            Device* dst = getDevice(it->toNode);
-            if (dst) dst->onPacketReceived(it->pkt);
-            it = inFlight_.erase(it);
-        } else {
-            ++it;
+    struct Arrival
+    {
+        int    toNode;
+        Packet pkt;
+    };
+
+    stepArena_.reset();
+    std::uint32_t* arrived = stepArena_.allocate<std::uint32_t>(inFlight_.size());
+    std::size_t count = inFlight_.advance(dt, arrived);
+    if (count == 0) return;
+
+    // pull arrivals out back to front so swap-remove never moves a pending one,
+    // then deliver them in row order
+    Arrival* out = stepArena_.allocate<Arrival>(count);
+    for (std::size_t k = count; k-- > 0;) {
+        std::uint32_t i = arrived[k];
+        if (Link* link = getLink(inFlight_.linkId(i))) {
+            link->currentLoad -= inFlight_.packet(i).sizeBytes;
         }
+        int toNode = inFlight_.toNode(i);
+        new (&out[k]) Arrival{ toNode, inFlight_.take(i) };
+    }
+    for (std::size_t k = 0; k < count; ++k) {
+        deliver(out[k].pkt, out[k].toNode);
+    }
+}
+
+bool Network::save(SnapshotWriter& out, std::string& error) const
+{
+    for (const auto& dev : devices_) {
+        if (dev->kind() == DeviceKind::Other) {
+            error = "device " + std::to_string(dev->id()) + " cannot be saved";
+            return false;
+        }
+    }
+
+    out.put(defaultBufferBytes_);
+    out.put(travelScale_);
+    out.put(minTravel_);
+    out.put(clock_);
+    out.put(advancedTo_);
+    out.put(nextLinkId_);
+    out.put(topologyVersion_);
+    out.put(stats_);
+    out.put(routing_.metric());
+
+    // devices in tick order, then node adjacency in routing order
+    out.put<std::uint64_t>(devices_.size());
+    for (const auto& dev : devices_) saveDevice(out, *dev);
+    out.put<std::uint64_t>(adjacency_.size());
+    for (const auto& ids : adjacency_) out.putVector(ids);
+
+    out.put<std::uint64_t>(links_.size());
+    for (const Link& l : links_) {
+        out.put(l.id);
+        out.put(l.nodeA);
+        out.put(l.nodeB);
+        out.put(l.bandwidthMbps);
+        out.put(l.latencyMs);
+        out.put(l.currentLoad);
+        out.put(l.remote);
+        out.put(l.up);
+        out.put(l.bufferBytes);
+        for (const LinkDirection& d : l.dir) {
+            out.put(d.busyUntil);
+            out.put(d.queuedBytes);
+            out.put(d.txPackets);
+            out.put(d.txBytes);
+            out.put(d.tailDrops);
+            out.put<std::uint64_t>(d.backlog.size());
+            for (std::size_t i = 0; i < d.backlog.size(); ++i) out.put(d.backlog[i]);
+        }
+    }
+
+    inFlight_.save(out);
+    return true;
+}
+
+bool Network::restore(SnapshotReader& in, std::string& error)
+{
+    if (!devices_.empty() || !links_.empty() || nextLinkId_ != 0) {
+        error = "restore needs an empty network";
+        return false;
+    }
+
+    in.get(defaultBufferBytes_);
+    in.get(travelScale_);
+    in.get(minTravel_);
+    in.get(clock_);
+    in.get(advancedTo_);
+    in.get(nextLinkId_);
+    in.get(topologyVersion_);
+    in.get(stats_);
+    routing_.setMetric(in.get<RouteMetric>());
+    routing_.clear();
+
+    const std::size_t deviceCount = in.getCount(sizeof(DeviceKind));
+    for (std::size_t i = 0; i < deviceCount && in.ok(); ++i) {
+        std::unique_ptr<Device> dev = restoreDevice(in);
+        if (!dev) {
+            in.fail();
+            break;
+        }
+        devices_.push_back(std::move(dev));
+    }
+
+    // the node table is bounded by the snapshot's size, a device id is not,
+    // so devices are only slotted once the table is read
+    const std::size_t nodes = in.getCount(sizeof(std::uint64_t));
+    if (nodes > 0 && in.ok()) ensureNode(static_cast<int>(nodes - 1));
+    for (std::size_t n = 0; n < nodes && in.ok(); ++n) in.getVector(adjacency_[n]);
+
+    for (std::size_t i = 0; i < devices_.size() && in.ok(); ++i) {
+        const int id = devices_[i]->id();
+        if (id < 0 || static_cast<std::size_t>(id) >= nodes || deviceSlot_[id] != -1) {
+            in.fail();
+            break;
+        }
+        deviceSlot_[id] = static_cast<int>(i);
+        attach(*devices_[i]);
+    }
+
+    const std::size_t linkCount = in.getCount(sizeof(int) * 3);
+    if (nextLinkId_ < 0 || nextLinkId_ > kMaxRestoredLinkIds) in.fail();
+    if (in.ok()) linkSlot_.assign(static_cast<std::size_t>(nextLinkId_), -1);
+    links_.reserve(linkCount);
+    for (std::size_t i = 0; i < linkCount && in.ok(); ++i) {
+        Link l;
+        in.get(l.id);
+        in.get(l.nodeA);
+        in.get(l.nodeB);
+        in.get(l.bandwidthMbps);
+        in.get(l.latencyMs);
+        in.get(l.currentLoad);
+        in.get(l.remote);
+        in.get(l.up);
+        in.get(l.bufferBytes);
+        for (LinkDirection& d : l.dir) {
+            in.get(d.busyUntil);
+            in.get(d.queuedBytes);
+            in.get(d.txPackets);
+            in.get(d.txBytes);
+            in.get(d.tailDrops);
+            const std::size_t pending = in.getCount(sizeof(LinkDirection::Pending));
+            for (std::size_t k = 0; k < pending && in.ok(); ++k) {
+                d.backlog.push_back(in.get<LinkDirection::Pending>());
+            }
+        }
+        if (l.id < 0 || l.id >= nextLinkId_ || linkSlot_[l.id] != -1 ||
+            l.nodeA < 0 || l.nodeB < 0 ||
+            static_cast<std::size_t>(l.nodeA) >= adjacency_.size() ||
+            static_cast<std::size_t>(l.nodeB) >= adjacency_.size()) {
+            in.fail();
+            break;
+        }
+        linkSlot_[l.id] = static_cast<int>(links_.size());
+        links_.push_back(std::move(l));
+    }
+
+    // every adjacency entry must name a restored link with that node on it,
+    // or findLink would index linkSlot_ with it unchecked
+    for (std::size_t n = 0; n < adjacency_.size() && in.ok(); ++n) {
+        for (int lid : adjacency_[n]) {
+            const Link* l = getLink(lid);
+            if (!l || (l->nodeA != static_cast<int>(n) && l->nodeB != static_cast<int>(n))) {
+                in.fail();
+                break;
+            }
+        }
+    }
+
+    if (in.ok()) inFlight_.restore(in, [this](int lid) { return getLink(lid) != nullptr; });
+    // and every packet must be travelling between its link's endpoints
+    for (std::size_t i = 0; i < inFlight_.size() && in.ok(); ++i) {
+        const Link* l = getLink(inFlight_.linkId(i));
+        const int from = inFlight_.fromNode(i), to = inFlight_.toNode(i);
+        if (!((l->nodeA == from && l->nodeB == to) || (l->nodeA == to && l->nodeB == from))) {
+            in.fail();
+        }
+    }
+    if (!in.ok()) {
+        error = "network section is malformed or truncated";
+        return false;
     }
+    return true;
 }
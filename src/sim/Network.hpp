@@ -1,8 +1,35 @@
 #pragma once
 #include "Device.hpp"
+#include "InFlightStore.hpp"
+#include "RingBuffer.hpp"
+#include "Routing.hpp"
+#include "StepArena.hpp"
+#include <functional>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+// One transmit side of a link. Packets are serialised one after another at
+// the link bandwidth; the backlog ring holds (txEnd, bytes) for every packet
+// not yet fully on the wire, which is what counts against the buffer.
+struct LinkDirection
+{
+    struct Pending
+    {
+        double        txEnd;
+        std::uint32_t bytes;
+    };
+
+    double                busyUntil   = 0.0; // when the transmitter frees up
+    std::uint64_t         queuedBytes = 0;
+    RingBuffer<Pending>   backlog;
+
+    std::uint64_t txPackets = 0;
+    std::uint64_t txBytes   = 0;
+    std::uint64_t tailDrops = 0;
+};
+
 struct Link 
 {
     int id;
@@ -10,43 +37,191 @@ struct Link
     int nodeB;
     double bandwidthMbps;
     double latencyMs;
-    double currentLoad = 0.0;
+    double currentLoad = 0.0;   // bytes queued or on the wire, both directions (local links)
+    bool   remote      = false; // nodeB lives in another partition
+    bool   up          = true;  // failed links stay in the topology but carry nothing
+    std::uint32_t bufferBytes = 0; // per direction, 0 = unlimited
+    LinkDirection dir[2];          // [0] nodeA -> nodeB, [1] nodeB -> nodeA
 };
 
-struct InFlightPacket
+struct NetworkStats
 {
-    Packet pkt;
-    int    linkId;
-    int    fromNode;
-    int    toNode;
-    double t          = 0.0; // 0.0 @ fromNode; 1.0 @ toNode
-    double travelTime = 0;   // seconds to go from A to B on this link
+    std::uint64_t packetsSent      = 0; // put on a link
+    std::uint64_t packetsDelivered = 0;
+    std::uint64_t packetsDropped   = 0; // no link between the endpoints, or link removed
+    std::uint64_t tailDrops        = 0; // transmit buffer full
+    std::uint64_t packetsForwarded = 0; // relayed by an intermediate node
+    std::uint64_t bytesDelivered   = 0;
+    std::uint64_t packetsEmitted   = 0; // sent by devices themselves, via the outbox
 };
 
 class Network 
 {
 public:
+    // receives packets sent over a remote link, with the time they take to cross it
+    using RemoteSink = std::function<void(const Packet& pkt, int fromNode, int toNode, double delay)>;
+    // sees every packet put on a link, with the time its transmission starts
+    using CaptureTap = std::function<void(const Packet& pkt, int linkId, int fromNode, int toNode, double time)>;
+
+    Network() = default;
+    Network(const Network&) = delete;
+    Network& operator=(const Network&) = delete;
+
     int addDevice(std::unique_ptr<Device> dev);
     int addLink(int a, int b, double bandwidthMbps, double latencyMs);
+    // link from a local device to one owned by another partition; packets
+    // sent over it go to the remote sink instead of travelling locally
+    int addRemoteLink(int local, int remote, double bandwidthMbps, double latencyMs);
+    void setRemoteSink(RemoteSink sink) { remoteSink_ = std::move(sink); }
+    // at most one tap; an empty one turns capture off
+    void setCaptureTap(CaptureTap tap) { captureTap_ = std::move(tap); }
+
+    // transmit buffer per link direction, in bytes; 0 = unlimited.
+    // The default applies to links added afterwards.
+    void setDefaultBufferBytes(std::uint32_t bytes) { defaultBufferBytes_ = bytes; }
+    bool setLinkBuffer(int linkId, std::uint32_t bytes);
+
+    // Stretch link travel for display: serialisation, queueing and latency
+    // are multiplied by `scale`, and each hop takes at least minSeconds.
+    // Queue spacing and drops still follow the real bandwidth.
+    void setTravelTimeScale(double scale, double minSeconds);
+
+    // capacity for a bulk load: node ids below nodeIds, plus room for that
+    // many more devices and links, and for n links on one node
+    void reserve(std::size_t nodeIds, std::size_t devices, std::size_t links);
+    void reserveLinksOf(int nodeId, std::size_t n);
+
+    // current simulated time, kept by Simulation; queueing is measured against it
+    void   setClock(double now) { clock_ = now; }
+    double clock() const { return clock_; }
+
+    // removing a device also removes its links; packets on a removed link are dropped
+    bool removeDevice(int id);
+    std::unique_ptr<Device> releaseDevice(int id);
+    bool removeLink(int id);
+    // take a link down or bring it back; packets on a failing link are dropped
+    bool setLinkUp(int id, bool up);
 
     Device* getDevice(int id);
     const Device* getDevice(int id) const;
 
+    Link* getLink(int id);
+    const Link* getLink(int id) const;
+    Link* findLink(int a, int b);
+    const Link* findLink(int a, int b) const;
+
+    // ids of the links attached to a node
+    const std::vector<int>& linksOf(int nodeId) const;
+    // one past the highest node id seen, local or remote
+    std::size_t nodeCapacity() const { return adjacency_.size(); }
+
     const std::vector<std::unique_ptr<Device>>& devices() const { return devices_; }
     std::vector<std::unique_ptr<Device>>& devices() { return devices_; }
 
     const std::vector<Link>& links() const { return links_; }
     std::vector<Link>& links() { return links_; }
 
+    // bumped whenever a device or link is added, removed, or goes up/down,
+    // so views can tell when cached geometry is stale
+    std::uint64_t topologyVersion() const { return topologyVersion_; }
+
+    // put pkt on a link from fromNode to its neighbour toNode: an up one if
+    // the two have several, dropped if none is up
     void spawnPacketOnLink(const Packet& pkt, int fromNode, int toNode);
+    // put pkt on link `linkId`, leaving from fromNode, as routing picked it;
+    // falls back to spawnPacketOnLink(fromNode, toNode) once it is gone or down
+    void transmit(const Packet& pkt, int linkId, int fromNode, int toNode);
+    // route pkt toward pkt.dstNodeId, one hop at a time
+    void sendPacket(const Packet& pkt, int fromNode);
     void updatePackets(double dt);
-    const std::vector<InFlightPacket>& inFlightPackets() const { return inFlight_; }
+    // Packets devices have sent since the last step, each addressed to
+    // pkt.dstNodeId. routeOutbox() fills in the first hop and drops (and
+    // counts) those with no route; the simulation schedules the rest and
+    // clears the outbox at the end of every step.
+    struct Outgoing
+    {
+        Packet pkt;
+        int    fromNode;
+        int    nextHop;
+        int    linkId; // the one routing chose toward nextHop
+        double delay;
+    };
+    std::vector<Outgoing>& routeOutbox();
+
+    // tick every device whose wakeup is due by `now`, earliest first; one
+    // that asks again for a time already due is ticked on the next call
+    void tickDevices(double now);
+    // earliest pending device wakeup, infinity if none; drops superseded
+    // entries off the top of the heap on the way
+    double nextWakeup();
+    // a packet reached toNode: forward it if it is addressed further on,
+    // otherwise hand it to the device there
+    void deliver(const Packet& pkt, int toNode);
+
+    Routing& routing() { return routing_; }
+    int nextHop(int from, int dst) { return routing_.nextHop(from, dst); }
+    int nextLink(int from, int dst) { return routing_.nextLink(from, dst); }
+    const InFlightStore& inFlight() const { return inFlight_; }
+    // per-link occupancy bins in the in-flight store, for level-of-detail views
+    void setPacketBinning(bool on) { inFlight_.setBinning(on); }
+
+    const NetworkStats& stats() const { return stats_; }
+
+    // Everything but the remote sink and capture tap, which belong to
+    // whoever set them, and the routing trees, which are rebuilt on use.
+    // save() fails if a device cannot be snapshotted (DeviceKind::Other);
+    // restore() needs an empty network.
+    bool save(SnapshotWriter& out, std::string& error) const;
+    bool restore(SnapshotReader& in, std::string& error);
 
 private:
-    const Link* findLink(int a, int b) const;
+    friend class Device; // Device::wakeAt and send queue here
+
+    // restore() treats a snapshot that has issued more link ids than this
+    // as corrupt rather than sizing linkSlot_ from it
+    static constexpr int kMaxRestoredLinkIds = 1 << 24;
+
+    struct Wakeup
+    {
+        double time;
+        int    deviceId;
+    };
+
+    static void eraseId(std::vector<int>& ids, int id);
+    static bool wakesLater(const Wakeup& a, const Wakeup& b);
+    void attach(Device& dev);
+    void queueWakeup(int deviceId, double at);
+    void dropPacketsOn(int linkId);
+    void ensureNode(int id);
+    void spawnOn(Link* link, const Packet& pkt, int fromNode, int toNode);
+    int  insertLink(int a, int b, double bandwidthMbps, double latencyMs, bool remote);
 
     std::vector<std::unique_ptr<Device>> devices_;
     std::vector<Link> links_;
-    std::vector<InFlightPacket> inFlight_;
+
+    // lookup indexes: id -> slot in devices_/links_ (-1 if absent),
+    // node id -> attached link ids
+    std::vector<int> deviceSlot_;
+    std::vector<int> linkSlot_;
+    std::vector<std::vector<int>> adjacency_;
+
+    InFlightStore inFlight_;
+    StepArena stepArena_; // scratch for updatePackets, reset every call
+    NetworkStats stats_;
+    RemoteSink remoteSink_;
+    CaptureTap captureTap_;
+    // min-heap on (time, id); an entry whose time no longer matches its
+    // device's wakeup was superseded and is skipped when it comes up
+    std::vector<Wakeup> wakeups_;
+    std::vector<int>    dueDevices_; // scratch for tickDevices
+    std::vector<Outgoing> outbox_;
+    Routing routing_{*this};
     int nextLinkId_ = 0;
+    std::uint64_t topologyVersion_ = 0;
+
+    std::uint32_t defaultBufferBytes_ = 0;
+    double travelScale_ = 1.0;
+    double minTravel_   = 0.0;
+    double clock_       = 0.0; // now, as set by the simulation
+    double advancedTo_  = 0.0; // time the in-flight progress columns describe
 };
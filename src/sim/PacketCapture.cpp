@@ -0,0 +1,93 @@
+#include "PacketCapture.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+void PacketCapture::captureLink(int linkId)
+{
+    if (linkId < 0) return;
+    if (static_cast<std::size_t>(linkId) >= linkChosen_.size()) linkChosen_.resize(linkId + 1, 0);
+    linkChosen_[linkId] = 1;
+    all_ = false;
+}
+
+void PacketCapture::captureDevice(int deviceId)
+{
+    if (deviceId < 0) return;
+    if (static_cast<std::size_t>(deviceId) >= deviceChosen_.size()) deviceChosen_.resize(deviceId + 1, 0);
+    deviceChosen_[deviceId] = 1;
+    all_ = false;
+}
+
+void PacketCapture::attach()
+{
+    network_.setCaptureTap([this](const Packet& pkt, int linkId, int fromNode, int toNode, double time) {
+        onPacket(pkt, linkId, fromNode, toNode, time);
+    });
+    attached_ = true;
+}
+
+void PacketCapture::detach()
+{
+    if (!attached_) return;
+    network_.setCaptureTap(nullptr);
+    attached_ = false;
+}
+
+bool PacketCapture::chosen(int linkId, int fromNode, int toNode) const
+{
+    if (all_) return true;
+    auto in = [](const std::vector<std::uint8_t>& set, int id) {
+        return static_cast<std::size_t>(id) < set.size() && set[id] != 0;
+    };
+    return in(linkChosen_, linkId) || in(deviceChosen_, fromNode) || in(deviceChosen_, toNode);
+}
+
+void PacketCapture::onPacket(const Packet& pkt, int linkId, int fromNode, int toNode, double time)
+{
+    if (!chosen(linkId, fromNode, toNode)) return;
+    const std::uint32_t iface = interfaceFor(linkId, fromNode, toNode);
+    // copies: looking up the second may grow the table under the first
+    const Mac src = macOf(fromNode);
+    const Mac dst = macOf(toNode);
+    writer_.write(pkt, time, iface, src.data(), dst.data());
+}
+
+std::uint32_t PacketCapture::interfaceFor(int linkId, int fromNode, int toNode)
+{
+    if (static_cast<std::size_t>(linkId) >= interface_.size()) interface_.resize(linkId + 1, -1);
+    std::int64_t& iface = interface_[linkId];
+    if (iface >= 0) return static_cast<std::uint32_t>(iface);
+
+    auto nameOf = [this](int id) {
+        const Device* dev = network_.getDevice(id);
+        return dev ? dev->info().name : "node " + std::to_string(id);
+    };
+    const int a = std::min(fromNode, toNode), b = std::max(fromNode, toNode);
+    iface = writer_.addInterface("link " + std::to_string(linkId) + ": " + nameOf(a) + " - " + nameOf(b));
+    return static_cast<std::uint32_t>(iface);
+}
+
+const PacketCapture::Mac& PacketCapture::macOf(int nodeId)
+{
+    const std::size_t i = static_cast<std::size_t>(nodeId);
+    if (i >= macs_.size()) {
+        macs_.resize(i + 1);
+        macKnown_.resize(i + 1, 0);
+    }
+    Mac& mac = macs_[i];
+    if (macKnown_[i]) return mac;
+    macKnown_[i] = 1;
+
+    unsigned b[6];
+    const Device* dev = network_.getDevice(nodeId);
+    if (dev && std::sscanf(dev->info().mac.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x",
+                           &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) == 6) {
+        for (int k = 0; k < 6; ++k) mac[k] = static_cast<std::uint8_t>(b[k]);
+    } else {
+        const std::uint32_t id = static_cast<std::uint32_t>(nodeId);
+        mac = { 0x02, 0x00, static_cast<std::uint8_t>(id >> 24), static_cast<std::uint8_t>(id >> 16),
+                static_cast<std::uint8_t>(id >> 8), static_cast<std::uint8_t>(id) };
+    }
+    return mac;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Network.hpp"
+#include "PcapWriter.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Feeds the packets a Network puts on its links into a PcapWriter. Capture
+// points are links, or devices (every link attached to one); with none
+// chosen, every link is captured. In pcapng each captured link becomes its
+// own interface, named after its endpoints, added the first time a packet
+// crosses it. Frames take their MAC addresses from DeviceInfo, or a
+// locally administered one derived from the node id when a device has none.
+//
+// The tap runs on the thread that runs the network, so a network split
+// over regions needs one capture and one writer per region.
+class PacketCapture
+{
+public:
+    PacketCapture(Network& net, PcapWriter& writer) : network_(net), writer_(writer) {}
+    ~PacketCapture() { detach(); }
+    PacketCapture(const PacketCapture&) = delete;
+    PacketCapture& operator=(const PacketCapture&) = delete;
+
+    void captureLink(int linkId);
+    void captureDevice(int deviceId);
+
+    // install or remove the network's capture tap
+    void attach();
+    void detach();
+
+private:
+    using Mac = std::array<std::uint8_t, 6>;
+
+    void onPacket(const Packet& pkt, int linkId, int fromNode, int toNode, double time);
+    bool chosen(int linkId, int fromNode, int toNode) const;
+    std::uint32_t interfaceFor(int linkId, int fromNode, int toNode);
+    const Mac& macOf(int nodeId);
+
+    Network&    network_;
+    PcapWriter& writer_;
+    bool        attached_ = false;
+
+    bool                      all_ = true;
+    std::vector<std::uint8_t> linkChosen_;   // by link id
+    std::vector<std::uint8_t> deviceChosen_; // by node id
+
+    std::vector<std::int64_t> interface_; // by link id, -1 = none yet
+    std::vector<Mac>          macs_;      // by node id
+    std::vector<std::uint8_t> macKnown_;
+};
@@ -0,0 +1,237 @@
+#include "ParallelSimulation.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+ParallelSimulation::ParallelSimulation(std::size_t regionCount, std::size_t threadCount)
+    : lookahead_(std::numeric_limits<double>::infinity())
+{
+    if (regionCount == 0) regionCount = 1;
+    for (std::size_t i = 0; i < regionCount; ++i) {
+        regions_.push_back(std::make_unique<Region>());
+        Region* r = regions_.back().get();
+        r->net.setRemoteSink([r](const Packet& pkt, int, int toNode, double delay) {
+            r->outbox.push_back(Crossing{ pkt, toNode, r->sim.time() + delay });
+        });
+    }
+
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, regionCount);
+    for (std::size_t i = 1; i < threadCount; ++i) {
+        workers_.emplace_back(&ParallelSimulation::workerMain, this);
+    }
+}
+
+ParallelSimulation::~ParallelSimulation()
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    startCv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+int ParallelSimulation::addDevice(std::size_t region, std::unique_ptr<Device> dev)
+{
+    if (region >= regions_.size()) return -1;
+    int id = regions_[region]->net.addDevice(std::move(dev));
+    if (id < 0) return -1;
+    if (static_cast<std::size_t>(id) >= deviceRegion_.size()) deviceRegion_.resize(id + 1, -1);
+    deviceRegion_[id] = static_cast<int>(region);
+    return id;
+}
+
+int ParallelSimulation::regionOf(int deviceId) const
+{
+    if (deviceId < 0 || static_cast<std::size_t>(deviceId) >= deviceRegion_.size()) return -1;
+    return deviceRegion_[deviceId];
+}
+
+int ParallelSimulation::addLink(int a, int b, double bandwidthMbps, double latencyMs)
+{
+    int ra = regionOf(a);
+    int rb = regionOf(b);
+    if (ra < 0 || rb < 0) return -1;
+    if (ra == rb) return regions_[ra]->net.addLink(a, b, bandwidthMbps, latencyMs);
+
+    if (latencyMs <= 0.0) return -1; // would leave no lookahead
+    int id = regions_[ra]->net.addRemoteLink(a, b, bandwidthMbps, latencyMs);
+    if (id < 0) return -1;
+    regions_[rb]->net.addRemoteLink(b, a, bandwidthMbps, latencyMs);
+    lookahead_ = std::min(lookahead_, latencyMs / 1000.0);
+    return id;
+}
+
+void ParallelSimulation::adopt(Network& net, const std::vector<int>& regionOfDevice)
+{
+    std::vector<Link> links = net.links();
+
+    std::vector<int> ids;
+    for (const auto& dev : net.devices()) ids.push_back(dev->id());
+    for (int id : ids) {
+        int region = (static_cast<std::size_t>(id) < regionOfDevice.size()) ? regionOfDevice[id] : 0;
+        addDevice(static_cast<std::size_t>(std::max(region, 0)), net.releaseDevice(id));
+    }
+    for (const Link& l : links) {
+        addLink(l.nodeA, l.nodeB, l.bandwidthMbps, l.latencyMs);
+    }
+}
+
+void ParallelSimulation::workerMain()
+{
+    std::uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            startCv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        drainRegions();
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (--busy_ == 0) doneCv_.notify_one();
+        }
+    }
+}
+
+void ParallelSimulation::drainRegions()
+{
+    // regions are claimed dynamically so uneven regions still balance
+    for (;;) {
+        std::size_t i = nextRegion_.fetch_add(1);
+        if (i >= regions_.size()) return;
+        regions_[i]->sim.run(windowEnd_, maxDt_);
+    }
+}
+
+void ParallelSimulation::runWindow(double end, double maxDt)
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        windowEnd_ = end;
+        maxDt_     = maxDt;
+        nextRegion_.store(0);
+        busy_ = workers_.size();
+        ++generation_;
+    }
+    startCv_.notify_all();
+
+    drainRegions();
+
+    std::unique_lock<std::mutex> lk(mu_);
+    doneCv_.wait(lk, [&] { return busy_ == 0; });
+}
+
+void ParallelSimulation::exchange()
+{
+    // region order keeps the hand-off deterministic regardless of threading
+    for (auto& r : regions_) {
+        for (const Crossing& c : r->outbox) {
+            int dst = regionOf(c.toNode);
+            if (dst < 0) continue;
+            regions_[dst]->sim.scheduleDelivery(c.pkt, c.toNode, c.arriveAt);
+        }
+        r->outbox.clear();
+    }
+}
+
+void ParallelSimulation::run(double until, double maxDt)
+{
+    while (time_ < until) {
+        // start the window at the first moment anything happens anywhere
+        double next = until;
+        for (const auto& r : regions_) {
+            if (!r->net.inFlight().empty()) { next = time_; break; }
+            next = std::min(next, std::min(r->sim.nextEventTime(), r->net.nextWakeup()));
+        }
+        double start = std::max(time_, next);
+        double end   = std::min(until, start + lookahead_);
+
+        runWindow(end, maxDt);
+        exchange();
+        time_ = end;
+        ++windows_;
+    }
+}
+
+NetworkStats ParallelSimulation::stats() const
+{
+    NetworkStats sum;
+    for (const auto& r : regions_) {
+        const NetworkStats& s = r->net.stats();
+        sum.packetsSent      += s.packetsSent;
+        sum.packetsDelivered += s.packetsDelivered;
+        sum.packetsDropped   += s.packetsDropped;
+        sum.tailDrops        += s.tailDrops;
+        sum.packetsForwarded += s.packetsForwarded;
+        sum.bytesDelivered   += s.bytesDelivered;
+        sum.packetsEmitted   += s.packetsEmitted;
+    }
+    return sum;
+}
+
+std::uint64_t ParallelSimulation::eventsProcessed() const
+{
+    std::uint64_t n = 0;
+    for (const auto& r : regions_) n += r->sim.eventsProcessed();
+    return n;
+}
+
+std::uint64_t ParallelSimulation::steps() const
+{
+    std::uint64_t n = 0;
+    for (const auto& r : regions_) n += r->sim.steps();
+    return n;
+}
+
+std::vector<int> ParallelSimulation::partitionByScope(const Network& net, std::size_t regionCount)
+{
+    if (regionCount == 0) regionCount = 1;
+
+    int maxId = -1;
+    for (const auto& dev : net.devices()) maxId = std::max(maxId, dev->id());
+    std::vector<int> parent(maxId + 1);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+
+    for (const Link& l : net.links()) {
+        const Device* a = net.getDevice(l.nodeA);
+        const Device* b = net.getDevice(l.nodeB);
+        if (!a || !b) continue;
+        bool cut = a->scope() != b->scope() && l.latencyMs > 0.0;
+        if (!cut) parent[find(l.nodeA)] = find(l.nodeB);
+    }
+
+    // islands, largest first, each into the least loaded region
+    std::vector<int> islandSize(maxId + 1, 0);
+    for (const auto& dev : net.devices()) ++islandSize[find(dev->id())];
+
+    std::vector<int> roots;
+    for (int id = 0; id <= maxId; ++id) {
+        if (islandSize[id] > 0) roots.push_back(id);
+    }
+    std::stable_sort(roots.begin(), roots.end(),
+                     [&](int x, int y) { return islandSize[x] > islandSize[y]; });
+
+    std::vector<std::size_t> load(regionCount, 0);
+    std::vector<int> islandRegion(maxId + 1, -1);
+    for (int root : roots) {
+        std::size_t best = std::min_element(load.begin(), load.end()) - load.begin();
+        islandRegion[root] = static_cast<int>(best);
+        load[best] += static_cast<std::size_t>(islandSize[root]);
+    }
+
+    std::vector<int> regionOfDevice(maxId + 1, -1);
+    for (const auto& dev : net.devices()) {
+        regionOfDevice[dev->id()] = islandRegion[find(dev->id())];
+    }
+    return regionOfDevice;
+}
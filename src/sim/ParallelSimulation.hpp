@@ -0,0 +1,95 @@
+#pragma once
+#include "Network.hpp"
+#include "Simulation.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a network split into regions, each with its own Network and
+// Simulation, on a pool of worker threads. Regions interact only through
+// remote links. Synchronisation is conservative: a packet crossing a cut
+// takes at least that link's latency, so with the smallest cut latency as
+// lookahead every region can run a whole window in parallel and still never
+// receive a packet stamped before its own clock.
+class ParallelSimulation
+{
+public:
+    // threadCount 0 = one per hardware thread, capped at regionCount
+    explicit ParallelSimulation(std::size_t regionCount, std::size_t threadCount = 0);
+    ~ParallelSimulation();
+
+    ParallelSimulation(const ParallelSimulation&) = delete;
+    ParallelSimulation& operator=(const ParallelSimulation&) = delete;
+
+    std::size_t regionCount() const { return regions_.size(); }
+    std::size_t threadCount() const { return workers_.size() + 1; }
+    Network&    network(std::size_t region)    { return regions_[region]->net; }
+    Simulation& simulation(std::size_t region) { return regions_[region]->sim; }
+
+    int addDevice(std::size_t region, std::unique_ptr<Device> dev);
+    // a link inside one region is an ordinary link; a link across regions
+    // becomes a remote link on each side and must have latencyMs > 0
+    int addLink(int a, int b, double bandwidthMbps, double latencyMs);
+    int regionOf(int deviceId) const;
+
+    // move every device and link of `net` into the regions given by
+    // regionOfDevice (indexed by device id); packets in flight are dropped
+    void adopt(Network& net, const std::vector<int>& regionOfDevice);
+
+    // all regions advance to `until` together, window by window
+    void run(double until, double maxDt);
+
+    double        time()      const { return time_; }
+    double        lookahead() const { return lookahead_; }
+    std::uint64_t windows()   const { return windows_; }
+    NetworkStats  stats()     const;
+    std::uint64_t eventsProcessed() const;
+    std::uint64_t steps()     const;
+
+    // Cut every link whose endpoints differ in NetworkScope (and that has
+    // non-zero latency), then pack the resulting islands, e.g. LANs behind
+    // their routers, into regionCount regions by device count.
+    static std::vector<int> partitionByScope(const Network& net, std::size_t regionCount);
+
+private:
+    struct Crossing
+    {
+        Packet pkt;
+        int    toNode;
+        double arriveAt;
+    };
+
+    struct Region
+    {
+        Network               net;
+        Simulation            sim{net};
+        std::vector<Crossing> outbox; // written only by the thread running this region
+    };
+
+    void runWindow(double end, double maxDt);
+    void drainRegions();
+    void exchange();
+    void workerMain();
+
+    std::vector<std::unique_ptr<Region>> regions_;
+    std::vector<int> deviceRegion_; // device id -> region, -1 if none
+
+    double        time_      = 0.0;
+    double        lookahead_;
+    std::uint64_t windows_   = 0;
+
+    // worker pool; one generation per window
+    std::vector<std::thread> workers_;
+    std::mutex               mu_;
+    std::condition_variable  startCv_;
+    std::condition_variable  doneCv_;
+    std::uint64_t            generation_ = 0;
+    std::size_t              busy_       = 0;
+    bool                     stop_       = false;
+    double                   windowEnd_  = 0.0;
+    double                   maxDt_      = 0.0;
+    std::atomic<std::size_t> nextRegion_{0};
+};
@@ -0,0 +1,333 @@
+#include "PcapWriter.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::uint32_t kLinkTypeEthernet = 1;
+constexpr std::uint32_t kSnapLength       = 65535;
+
+constexpr std::uint32_t kPcapMagicNs      = 0xa1b23c4d; // nanosecond timestamps
+constexpr std::uint32_t kBlockSection     = 0x0A0D0D0A;
+constexpr std::uint32_t kBlockInterface   = 1;
+constexpr std::uint32_t kBlockEnhanced    = 6;
+constexpr std::uint32_t kByteOrderMagic   = 0x1A2B3C4D;
+constexpr std::uint16_t kOptEnd           = 0;
+constexpr std::uint16_t kOptIfName        = 2;
+constexpr std::uint16_t kOptIfTsResol     = 9;
+
+constexpr std::size_t kMaxInterfaceName = 255;
+
+std::size_t pad4(std::size_t n) { return (n + 3) & ~std::size_t(3); }
+
+// file framing is in native byte order (the magic numbers tell readers
+// which); the synthesised headers are in network byte order
+template <typename T>
+std::uint8_t* putNative(std::uint8_t* p, T v)
+{
+    std::memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+std::uint8_t* put16(std::uint8_t* p, std::uint16_t v)
+{
+    p[0] = static_cast<std::uint8_t>(v >> 8);
+    p[1] = static_cast<std::uint8_t>(v);
+    return p + 2;
+}
+
+std::uint8_t* put32(std::uint8_t* p, std::uint32_t v)
+{
+    p[0] = static_cast<std::uint8_t>(v >> 24);
+    p[1] = static_cast<std::uint8_t>(v >> 16);
+    p[2] = static_cast<std::uint8_t>(v >> 8);
+    p[3] = static_cast<std::uint8_t>(v);
+    return p + 4;
+}
+
+std::uint16_t ipv4Checksum(const std::uint8_t* h)
+{
+    std::uint32_t sum = 0;
+    for (int i = 0; i < 20; i += 2) sum += (std::uint32_t(h[i]) << 8) | h[i + 1];
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<std::uint16_t>(~sum);
+}
+
+// Ethernet + IP + TCP/UDP headers for pkt at `out`; returns the frame
+// bytes written and sets `wireLength` to the full frame length
+std::size_t buildFrame(std::uint8_t* out, const Packet& pkt,
+                       const std::uint8_t srcMac[6], const std::uint8_t dstMac[6],
+                       std::uint32_t& wireLength)
+{
+    const bool v6  = pkt.family == AddressFamily::IPv6;
+    const bool tcp = pkt.transport == TransportProtocol::TCP;
+    const std::size_t ipHeader = v6 ? 40 : 20;
+    const std::size_t l4Header = tcp ? 20 : 8;
+    const std::uint32_t ipLength = std::max<std::uint32_t>(
+        pkt.sizeBytes, static_cast<std::uint32_t>(ipHeader + l4Header));
+    wireLength = 14 + ipLength;
+
+    std::uint8_t* p = out;
+    std::memcpy(p, dstMac, 6);
+    std::memcpy(p + 6, srcMac, 6);
+    p = put16(p + 12, v6 ? 0x86DD : 0x0800);
+
+    const std::uint8_t proto = tcp ? 6 : 17;
+    if (v6) {
+        const std::uint32_t payload = std::min<std::uint32_t>(ipLength - 40, 0xFFFF);
+        p = put32(p, 0x60000000u);
+        p = put16(p, static_cast<std::uint16_t>(payload));
+        *p++ = proto;
+        *p++ = 64; // hop limit
+        const Ipv6Table& table = ipv6Table();
+        for (IpAddress handle : { pkt.srcIp, pkt.dstIp }) {
+            if (handle < table.size()) std::memcpy(p, table.lookup(handle).data(), 16);
+            else std::memset(p, 0, 16);
+            p += 16;
+        }
+    } else {
+        std::uint8_t* h = p;
+        *p++ = 0x45;
+        *p++ = 0;
+        p = put16(p, static_cast<std::uint16_t>(std::min<std::uint32_t>(ipLength, 0xFFFF)));
+        p = put16(p, static_cast<std::uint16_t>(pkt.id));
+        p = put16(p, 0x4000); // don't fragment
+        *p++ = 64;            // ttl
+        *p++ = proto;
+        p = put16(p, 0);
+        p = put32(p, pkt.srcIp);
+        p = put32(p, pkt.dstIp);
+        put16(h + 10, ipv4Checksum(h));
+    }
+
+    // transport checksums are left zero: "none" for UDP over IPv4, and
+    // analysers do not verify TCP checksums by default
+    p = put16(p, pkt.srcPort);
+    p = put16(p, pkt.dstPort);
+    if (tcp) {
+        p = put32(p, static_cast<std::uint32_t>(pkt.id)); // sequence
+        p = put32(p, 0);                                  // ack
+        *p++ = 5 << 4;                                    // data offset
+        *p++ = 0x18;                                      // PSH, ACK
+        p = put16(p, 0xFFFF);                             // window
+        p = put16(p, 0);                                  // checksum
+        p = put16(p, 0);                                  // urgent
+    } else {
+        const std::uint32_t udpLength = ipLength - static_cast<std::uint32_t>(ipHeader);
+        p = put16(p, static_cast<std::uint16_t>(std::min<std::uint32_t>(udpLength, 0xFFFF)));
+        p = put16(p, 0);
+    }
+    return static_cast<std::size_t>(p - out);
+}
+
+} // namespace
+
+bool PcapWriter::open(const std::string& path, CaptureFormat format, std::string& error)
+{
+    close();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        error = std::string("cannot create: ") + std::strerror(errno);
+        return false;
+    }
+    format_  = format;
+    packets_ = 0;
+    dropped_ = 0;
+    stop_    = false;
+    ioError_.clear();
+    current_ = std::make_unique<Buffer>();
+    buffers_ = 1;
+
+    std::uint8_t* p = current_->data.get();
+    if (format_ == CaptureFormat::Pcap) {
+        p = putNative<std::uint32_t>(p, kPcapMagicNs);
+        p = putNative<std::uint16_t>(p, 2);
+        p = putNative<std::uint16_t>(p, 4);
+        p = putNative<std::int32_t>(p, 0);  // thiszone
+        p = putNative<std::uint32_t>(p, 0); // sigfigs
+        p = putNative<std::uint32_t>(p, kSnapLength);
+        p = putNative<std::uint32_t>(p, kLinkTypeEthernet);
+        interfaces_ = 1;
+    } else {
+        p = putNative<std::uint32_t>(p, kBlockSection);
+        p = putNative<std::uint32_t>(p, 28);
+        p = putNative<std::uint32_t>(p, kByteOrderMagic);
+        p = putNative<std::uint16_t>(p, 1);
+        p = putNative<std::uint16_t>(p, 0);
+        p = putNative<std::int64_t>(p, -1); // section length unknown
+        p = putNative<std::uint32_t>(p, 28);
+        interfaces_ = 0;
+    }
+    current_->used = static_cast<std::size_t>(p - current_->data.get());
+
+    io_ = std::thread([this] { ioMain(); });
+    return true;
+}
+
+bool PcapWriter::close(std::string& error)
+{
+    if (fd_ < 0) return true;
+    flush();
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    io_.join();
+    ::close(fd_);
+    fd_ = -1;
+
+    current_.reset();
+    free_.clear();
+    buffers_ = 0;
+    if (!ioError_.empty()) {
+        error = ioError_;
+        return false;
+    }
+    return true;
+}
+
+std::uint32_t PcapWriter::addInterface(const std::string& name)
+{
+    if (fd_ < 0 || format_ == CaptureFormat::Pcap) return 0;
+
+    // an interface block cannot be dropped without breaking every record
+    // that refers to it, so it may take one buffer past the limit
+    if (!reserve(kMaxRecord) && !current_) {
+        current_ = std::make_unique<Buffer>();
+        ++buffers_;
+    }
+
+    const std::size_t nameLength = std::min(name.size(), kMaxInterfaceName);
+    const std::uint32_t total = static_cast<std::uint32_t>(
+        8 + 8 + 4 + pad4(nameLength) + 8 + 4 + 4);
+
+    std::uint8_t* p = current_->data.get() + current_->used;
+    p = putNative<std::uint32_t>(p, kBlockInterface);
+    p = putNative<std::uint32_t>(p, total);
+    p = putNative<std::uint16_t>(p, static_cast<std::uint16_t>(kLinkTypeEthernet));
+    p = putNative<std::uint16_t>(p, 0);
+    p = putNative<std::uint32_t>(p, kSnapLength);
+    p = putNative<std::uint16_t>(p, kOptIfName);
+    p = putNative<std::uint16_t>(p, static_cast<std::uint16_t>(nameLength));
+    std::memcpy(p, name.data(), nameLength);
+    std::memset(p + nameLength, 0, pad4(nameLength) - nameLength);
+    p += pad4(nameLength);
+    p = putNative<std::uint16_t>(p, kOptIfTsResol);
+    p = putNative<std::uint16_t>(p, 1);
+    *p++ = 9; // 10^-9 s
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = 0;
+    p = putNative<std::uint16_t>(p, kOptEnd);
+    p = putNative<std::uint16_t>(p, 0);
+    p = putNative<std::uint32_t>(p, total);
+    current_->used = static_cast<std::size_t>(p - current_->data.get());
+    return interfaces_++;
+}
+
+void PcapWriter::write(const Packet& pkt, double time, std::uint32_t interface,
+                       const std::uint8_t srcMac[6], const std::uint8_t dstMac[6])
+{
+    if (fd_ < 0) return;
+    if (!reserve(kMaxRecord)) {
+        ++dropped_;
+        return;
+    }
+
+    const std::uint64_t ns = time > 0.0 ? static_cast<std::uint64_t>(time * 1e9 + 0.5) : 0;
+    std::uint8_t* record = current_->data.get() + current_->used;
+    std::uint32_t wireLength = 0;
+    std::uint8_t* p;
+
+    if (format_ == CaptureFormat::Pcap) {
+        const std::size_t frame = buildFrame(record + 16, pkt, srcMac, dstMac, wireLength);
+        p = putNative<std::uint32_t>(record, static_cast<std::uint32_t>(ns / 1000000000u));
+        p = putNative<std::uint32_t>(p, static_cast<std::uint32_t>(ns % 1000000000u));
+        p = putNative<std::uint32_t>(p, static_cast<std::uint32_t>(frame));
+        p = putNative<std::uint32_t>(p, wireLength);
+        p += frame;
+    } else {
+        const std::size_t frame = buildFrame(record + 28, pkt, srcMac, dstMac, wireLength);
+        const std::size_t padded = pad4(frame);
+        const std::uint32_t total = static_cast<std::uint32_t>(32 + padded);
+        p = putNative<std::uint32_t>(record, kBlockEnhanced);
+        p = putNative<std::uint32_t>(p, total);
+        p = putNative<std::uint32_t>(p, interface);
+        p = putNative<std::uint32_t>(p, static_cast<std::uint32_t>(ns >> 32));
+        p = putNative<std::uint32_t>(p, static_cast<std::uint32_t>(ns));
+        p = putNative<std::uint32_t>(p, static_cast<std::uint32_t>(frame));
+        p = putNative<std::uint32_t>(p, wireLength);
+        std::memset(p + frame, 0, padded - frame);
+        p = putNative<std::uint32_t>(p + padded, total);
+    }
+    current_->used = static_cast<std::size_t>(p - current_->data.get());
+    ++packets_;
+}
+
+void PcapWriter::flush()
+{
+    if (fd_ < 0) return;
+    handOff();
+}
+
+bool PcapWriter::reserve(std::size_t bytes)
+{
+    if (current_ && current_->used + bytes <= kBufferBytes) return true;
+    handOff();
+    return current_ && current_->used + bytes <= kBufferBytes;
+}
+
+void PcapWriter::handOff()
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (current_ && current_->used > 0) full_.push_back(std::move(current_));
+        if (!current_ && !free_.empty()) {
+            current_ = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+    cv_.notify_one();
+    if (!current_ && buffers_ < kMaxBuffers) {
+        current_ = std::make_unique<Buffer>();
+        ++buffers_;
+    }
+}
+
+void PcapWriter::ioMain()
+{
+    std::unique_lock<std::mutex> lk(mu_);
+    for (;;) {
+        cv_.wait(lk, [this] { return stop_ || !full_.empty(); });
+        if (full_.empty()) return; // stopping, and everything is written
+
+        std::unique_ptr<Buffer> buf = std::move(full_.front());
+        full_.pop_front();
+        const bool failed = !ioError_.empty();
+        lk.unlock();
+
+        // after a failed write the rest is discarded; close() reports it
+        std::string error;
+        const std::uint8_t* p = buf->data.get();
+        std::size_t left = failed ? 0 : buf->used;
+        while (left > 0) {
+            ssize_t n = ::write(fd_, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                error = std::string("write failed: ") + std::strerror(errno);
+                break;
+            }
+            p += n;
+            left -= static_cast<std::size_t>(n);
+        }
+        buf->used = 0;
+
+        lk.lock();
+        if (!error.empty()) ioError_ = error;
+        free_.push_back(std::move(buf));
+    }
+}
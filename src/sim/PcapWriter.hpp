@@ -0,0 +1,96 @@
+#pragma once
+#include "Device.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class CaptureFormat
+{
+    Pcap,   // classic libpcap, nanosecond timestamps
+    PcapNg  // one interface block per capture point
+};
+
+// Writes simulated packets as a capture file that standard tools open.
+// Each packet becomes an Ethernet frame with synthesised IPv4 or IPv6 and
+// TCP or UDP headers; the payload is not stored, so frames are truncated to
+// their headers and carry the full on-wire length as the original length.
+//
+// Records are built straight into large buffers. A full buffer is handed to
+// a background thread that writes it out and returns it for reuse, so the
+// simulation thread never waits on the disk. If the disk falls behind by
+// more than kMaxBuffers buffers, further records are dropped and counted
+// rather than stalling the caller. write() and addInterface() must be
+// called from one thread at a time.
+class PcapWriter
+{
+public:
+    static constexpr std::size_t kBufferBytes = 4u << 20;
+    static constexpr std::size_t kMaxBuffers  = 64;
+
+    PcapWriter() = default;
+    ~PcapWriter() { close(); }
+    PcapWriter(const PcapWriter&) = delete;
+    PcapWriter& operator=(const PcapWriter&) = delete;
+
+    // creates the file, writes its header and starts the I/O thread
+    bool open(const std::string& path, CaptureFormat format, std::string& error);
+    // writes out everything buffered and stops the I/O thread; false if
+    // any write failed, with the reason in `error`
+    bool close(std::string& error);
+    void close() { std::string ignored; close(ignored); }
+    bool isOpen() const { return fd_ >= 0; }
+
+    // a capture point; pcapng gets an interface block named `name`, classic
+    // pcap has a single interface and always returns 0
+    std::uint32_t addInterface(const std::string& name);
+
+    // one frame seen on `interface` at simulated time `time` (seconds)
+    void write(const Packet& pkt, double time, std::uint32_t interface,
+               const std::uint8_t srcMac[6], const std::uint8_t dstMac[6]);
+    // hand the partly filled buffer to the I/O thread now
+    void flush();
+
+    std::uint64_t packets() const { return packets_; }
+    std::uint64_t dropped() const { return dropped_; }
+
+private:
+    struct Buffer
+    {
+        std::unique_ptr<std::uint8_t[]> data{new std::uint8_t[kBufferBytes]};
+        std::size_t                     used = 0;
+    };
+
+    // room for the largest record: pcapng block framing plus Ethernet,
+    // IPv6 and TCP headers, or an interface block with a long name
+    static constexpr std::size_t kMaxRecord = 512;
+
+    bool reserve(std::size_t bytes);
+    void handOff();
+    void ioMain();
+
+    CaptureFormat format_ = CaptureFormat::Pcap;
+    int           fd_     = -1;
+    std::uint32_t interfaces_ = 0;
+
+    // producer side
+    std::unique_ptr<Buffer> current_;
+    std::size_t             buffers_ = 0; // allocated so far
+    std::uint64_t           packets_ = 0;
+    std::uint64_t           dropped_ = 0;
+
+    // shared with the I/O thread
+    std::mutex                          mu_;
+    std::condition_variable             cv_;
+    std::deque<std::unique_ptr<Buffer>> full_;
+    std::vector<std::unique_ptr<Buffer>> free_;
+    bool                                stop_ = false;
+    std::string                         ioError_;
+
+    std::thread io_;
+};
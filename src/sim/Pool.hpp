@@ -0,0 +1,54 @@
+#pragma once
+#include "Profiler.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Slab allocator for fixed-size records. Storage comes in chunks of
+// 2^ChunkBits elements that never move, so a handle (and any reference
+// taken from it) stays valid until the record is released. Released
+// handles are reused last-in first-out, while their memory is still warm.
+template <typename T, unsigned ChunkBits = 12>
+class SlabPool
+{
+public:
+    using Handle = std::uint32_t;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << ChunkBits;
+
+    Handle acquire(T value)
+    {
+        Handle h;
+        if (!free_.empty()) {
+            h = free_.back();
+            free_.pop_back();
+        } else {
+            if (next_ == chunks_.size() * kChunkSize) {
+                chunks_.push_back(std::make_unique<T[]>(kChunkSize));
+                NETSIM_COUNT(Allocations, 1);
+            }
+            h = static_cast<Handle>(next_++);
+        }
+        (*this)[h] = std::move(value);
+        return h;
+    }
+
+    void release(Handle h) { free_.push_back(h); }
+
+    T&       operator[](Handle h)       { return chunks_[h >> ChunkBits][h & (kChunkSize - 1)]; }
+    const T& operator[](Handle h) const { return chunks_[h >> ChunkBits][h & (kChunkSize - 1)]; }
+
+    std::size_t live()     const { return next_ - free_.size(); }
+    std::size_t capacity() const { return chunks_.size() * kChunkSize; }
+
+    // forget every record but keep the chunks for reuse
+    void clear()
+    {
+        next_ = 0;
+        free_.clear();
+    }
+
+private:
+    std::vector<std::unique_ptr<T[]>> chunks_;
+    std::vector<Handle>               free_;
+    std::size_t                       next_ = 0;
+};
@@ -0,0 +1,183 @@
+#include "Profiler.hpp"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <thread>
+
+const char* phaseName(Phase phase)
+{
+    switch (phase) {
+    case Phase::Input:      return "input";
+    case Phase::Step:       return "step";
+    case Phase::DeviceTick: return "device_tick";
+    case Phase::Events:     return "events";
+    case Phase::Traffic:    return "traffic";
+    case Phase::PacketMove: return "packet_move";
+    case Phase::Outbox:     return "outbox";
+    case Phase::Render:     return "render";
+    case Phase::Panels:     return "panels";
+    case Phase::Count:      break;
+    }
+    return "?";
+}
+
+const char* counterName(Counter counter)
+{
+    switch (counter) {
+    case Counter::EventsProcessed:  return "events";
+    case Counter::PacketsSpawned:   return "spawned";
+    case Counter::PacketsDelivered: return "delivered";
+    case Counter::PacketsDropped:   return "dropped";
+    case Counter::Allocations:      return "allocations";
+    case Counter::Count:            break;
+    }
+    return "?";
+}
+
+struct Profiler::Exporter
+{
+    std::ofstream            out;
+    bool                     json        = false;
+    bool                     firstRecord = true;
+    std::mutex               mu;
+    std::condition_variable  cv;
+    std::deque<ProfileFrame> queue;
+    bool                     stop = false;
+    std::thread              writer;
+
+    void run();
+    void write(const ProfileFrame& frame);
+};
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() = default;
+
+Profiler::~Profiler()
+{
+    stopExport();
+}
+
+Profiler::Block& Profiler::local()
+{
+    // the profiler keeps a reference, so totals survive the thread
+    thread_local Block* block = nullptr;
+    if (!block) {
+        auto owned = std::make_shared<Block>();
+        block = owned.get();
+        std::lock_guard<std::mutex> lk(blocksMu_);
+        blocks_.push_back(std::move(owned));
+    }
+    return *block;
+}
+
+const ProfileFrame& Profiler::endFrame()
+{
+    std::array<std::uint64_t, kPhaseCount>   ns{};
+    std::array<std::uint64_t, kCounterCount> counts{};
+    {
+        std::lock_guard<std::mutex> lk(blocksMu_);
+        for (const auto& b : blocks_) {
+            for (std::size_t i = 0; i < kPhaseCount; ++i)   ns[i]     += b->phaseNs[i].load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < kCounterCount; ++i) counts[i] += b->counts[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    Clock::time_point now = Clock::now();
+    ProfileFrame frame;
+    frame.index  = last_.index + 1;
+    frame.wallMs = std::chrono::duration<double, std::milli>(now - frameStart_).count();
+    frameStart_  = now;
+    for (std::size_t i = 0; i < kPhaseCount; ++i)   frame.phaseNs[i] = ns[i] - seenNs_[i];
+    for (std::size_t i = 0; i < kCounterCount; ++i) frame.counts[i]  = counts[i] - seenCounts_[i];
+    seenNs_     = ns;
+    seenCounts_ = counts;
+    last_       = frame;
+
+    if (exporter_) {
+        std::lock_guard<std::mutex> lk(exporter_->mu);
+        exporter_->queue.push_back(frame);
+        exporter_->cv.notify_one();
+    }
+    return last_;
+}
+
+bool Profiler::startExport(const std::string& path)
+{
+    stopExport();
+    auto ex = std::make_unique<Exporter>();
+    ex->out.open(path);
+    if (!ex->out) return false;
+
+    std::ofstream& out = ex->out;
+    ex->json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (ex->json) {
+        out << "[\n";
+    } else {
+        out << "frame,wall_ms";
+        for (std::size_t i = 0; i < kPhaseCount; ++i)   out << ',' << phaseName(static_cast<Phase>(i)) << "_ms";
+        for (std::size_t i = 0; i < kCounterCount; ++i) out << ',' << counterName(static_cast<Counter>(i));
+        out << '\n';
+    }
+
+    ex->writer = std::thread(&Exporter::run, ex.get());
+    exporter_ = std::move(ex);
+    return true;
+}
+
+void Profiler::stopExport()
+{
+    if (!exporter_) return;
+    {
+        std::lock_guard<std::mutex> lk(exporter_->mu);
+        exporter_->stop = true;
+    }
+    exporter_->cv.notify_one();
+    exporter_->writer.join();
+
+    if (exporter_->json) exporter_->out << "\n]\n";
+    exporter_.reset();
+}
+
+void Profiler::Exporter::run()
+{
+    std::deque<ProfileFrame> batch;
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lk(mu);
+            cv.wait(lk, [this] { return stop || !queue.empty(); });
+            batch.swap(queue);
+            stopping = stop;
+        }
+        for (const ProfileFrame& f : batch) write(f);
+        batch.clear();
+        out.flush();
+        if (stopping) return;
+    }
+}
+
+void Profiler::Exporter::write(const ProfileFrame& f)
+{
+    if (json) {
+        out << (firstRecord ? "" : ",\n")
+            << "  { \"frame\": " << f.index << ", \"wall_ms\": " << f.wallMs;
+        for (std::size_t i = 0; i < kPhaseCount; ++i) {
+            out << ", \"" << phaseName(static_cast<Phase>(i)) << "_ms\": " << f.phaseNs[i] / 1e6;
+        }
+        for (std::size_t i = 0; i < kCounterCount; ++i) {
+            out << ", \"" << counterName(static_cast<Counter>(i)) << "\": " << f.counts[i];
+        }
+        out << " }";
+    } else {
+        out << f.index << ',' << f.wallMs;
+        for (std::size_t i = 0; i < kPhaseCount; ++i)   out << ',' << f.phaseNs[i] / 1e6;
+        for (std::size_t i = 0; i < kCounterCount; ++i) out << ',' << f.counts[i];
+        out << '\n';
+    }
+    firstRecord = false;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Phase timers and event counters for the hot paths. Instrumented code uses
+// the NETSIM_PROFILE_SCOPE / NETSIM_COUNT macros below; they compile to
+// nothing unless the build defines NETSIM_PROFILE (make PROFILE=1).
+//
+// Each thread accumulates into its own block, so parallel regions never
+// contend. Once per frame the owner calls endFrame(), which folds the blocks
+// into a ProfileFrame of deltas: the latest one feeds the GUI overlay, and if
+// an export is running the frame is queued for a background thread that
+// writes it out as CSV or JSON.
+
+enum class Phase : std::uint8_t
+{
+    Input,       // GUI event polling
+    Step,        // Simulation::step, everything below included
+    DeviceTick,
+    Events,      // firing due events
+    Traffic,     // timer callbacks, i.e. traffic generation
+    PacketMove,  // Network::updatePackets
+    Outbox,      // scheduling what devices sent, e.g. the router's replies
+    Render,      // Renderer::draw
+    Panels,      // node/link panels
+    Count
+};
+
+enum class Counter : std::uint8_t
+{
+    EventsProcessed,
+    PacketsSpawned,
+    PacketsDelivered,
+    PacketsDropped,
+    Allocations,  // heap blocks taken by the slab, arena and ring allocators
+    Count
+};
+
+constexpr std::size_t kPhaseCount   = static_cast<std::size_t>(Phase::Count);
+constexpr std::size_t kCounterCount = static_cast<std::size_t>(Counter::Count);
+
+const char* phaseName(Phase phase);
+const char* counterName(Counter counter);
+
+struct ProfileFrame
+{
+    std::uint64_t index  = 0;
+    double        wallMs = 0.0; // since the previous endFrame()
+    std::array<std::uint64_t, kPhaseCount>   phaseNs{};
+    std::array<std::uint64_t, kCounterCount> counts{};
+};
+
+class Profiler
+{
+public:
+    static Profiler& instance();
+
+    ~Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void addTime(Phase phase, std::uint64_t ns) { bump(local().phaseNs[static_cast<std::size_t>(phase)], ns); }
+    void count(Counter counter, std::uint64_t n = 1) { bump(local().counts[static_cast<std::size_t>(counter)], n); }
+
+    // close the current frame; returns it (also kept as lastFrame())
+    const ProfileFrame& endFrame();
+    const ProfileFrame& lastFrame() const { return last_; }
+
+    // stream every frame from now on to `path`, as JSON if it ends in
+    // ".json" and CSV otherwise; false if the file can't be opened
+    bool startExport(const std::string& path);
+    void stopExport();
+    bool exporting() const { return exporter_ != nullptr; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // written by one thread only; atomics just make the cross-thread read safe
+    struct Block
+    {
+        std::array<std::atomic<std::uint64_t>, kPhaseCount>   phaseNs{};
+        std::array<std::atomic<std::uint64_t>, kCounterCount> counts{};
+    };
+
+    Profiler();
+
+    static void bump(std::atomic<std::uint64_t>& slot, std::uint64_t n)
+    {
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    Block& local();
+
+    std::mutex                          blocksMu_;
+    std::vector<std::shared_ptr<Block>> blocks_;
+
+    // only touched by the thread calling endFrame()
+    ProfileFrame                             last_;
+    std::array<std::uint64_t, kPhaseCount>   seenNs_{};
+    std::array<std::uint64_t, kCounterCount> seenCounts_{};
+    Clock::time_point                        frameStart_ = Clock::now();
+
+    struct Exporter; // the file, a frame queue and the thread draining it
+    std::unique_ptr<Exporter> exporter_;
+};
+
+// adds the lifetime of the enclosing scope to `phase`
+class ScopedPhase
+{
+public:
+    explicit ScopedPhase(Phase phase) : phase_(phase), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedPhase()
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        Profiler::instance().addTime(phase_, static_cast<std::uint64_t>(ns));
+    }
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    Phase                                 phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define NETSIM_CONCAT_(a, b) a##b
+#define NETSIM_CONCAT(a, b) NETSIM_CONCAT_(a, b)
+
+#ifdef NETSIM_PROFILE
+constexpr bool kProfilerEnabled = true;
+#define NETSIM_PROFILE_SCOPE(phase) ScopedPhase NETSIM_CONCAT(profileScope_, __LINE__)(Phase::phase)
+#define NETSIM_COUNT(counter, n)    Profiler::instance().count(Counter::counter, (n))
+#else
+constexpr bool kProfilerEnabled = false;
+#define NETSIM_PROFILE_SCOPE(phase) ((void)0)
+#define NETSIM_COUNT(counter, n)    ((void)0)
+#endif
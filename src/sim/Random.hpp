@@ -0,0 +1,66 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Counter-based generator: draw i is a pure function of (key, i), the
+// SplitMix64 finaliser applied to key + (i + 1) * golden ratio, the usual
+// SplitMix sequence; starting at 1 keeps a zero key from drawing mix(0) = 0
+// first, which would make a far outlying exponential gap. Nothing carries
+// from one draw to the next, so the batch fills below are plain loops the
+// compiler can vectorise, and skipping ahead is an addition.
+//
+// Streams are keyed by (global seed, owner, stream): the owner is a device
+// id, the stream tells apart the draws one owner makes for different
+// purposes. A stream's draws depend on nothing else, so they come out the
+// same however devices are spread over regions and threads. The whole
+// state is 16 bytes.
+class CounterRng
+{
+public:
+    explicit CounterRng(std::uint64_t seed = 0) : key_(mix(seed)) {}
+    CounterRng(std::uint64_t seed, std::uint64_t owner, std::uint64_t stream)
+        : key_(mix(mix(mix(seed) ^ owner) ^ (stream * kGamma))) {}
+
+    // draws made so far; skip() moves ahead without drawing
+    std::uint64_t position() const { return counter_; }
+    void          skip(std::uint64_t n) { counter_ += n; }
+
+    std::uint64_t next() { return mix(key_ + kGamma * ++counter_); }
+
+    // uniform in (0, 1], so log() of it is always finite
+    double uniform() { return toUnit(next()); }
+
+    void fillUniform(double* out, std::size_t n)
+    {
+        const std::uint64_t base = key_ + kGamma * (counter_ + 1);
+        for (std::size_t i = 0; i < n; ++i) out[i] = toUnit(mix(base + kGamma * i));
+        counter_ += n;
+    }
+
+    // exponential with the given rate (mean 1 / rate)
+    void fillExponential(double* out, std::size_t n, double rate)
+    {
+        fillUniform(out, n);
+        const double scale = -1.0 / rate;
+        for (std::size_t i = 0; i < n; ++i) out[i] = scale * std::log(out[i]);
+    }
+
+    static std::uint64_t mix(std::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    static constexpr std::uint64_t kGamma = 0x9e3779b97f4a7c15ull;
+
+    static double toUnit(std::uint64_t x)
+    {
+        return static_cast<double>((x >> 11) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+    std::uint64_t key_;
+    std::uint64_t counter_ = 0;
+};
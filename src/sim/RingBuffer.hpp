@@ -0,0 +1,55 @@
+#pragma once
+#include "Profiler.hpp"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// FIFO over a power-of-two circular array that doubles when full.
+// push_back/pop_front are O(1); nothing allocates once it has warmed up.
+template <typename T>
+class RingBuffer
+{
+public:
+    bool        empty() const { return size_ == 0; }
+    std::size_t size()  const { return size_; }
+
+    T&       front()       { return buf_[head_]; }
+    const T& front() const { return buf_[head_]; }
+    // i-th element from the front
+    const T& operator[](std::size_t i) const { return buf_[(head_ + i) & (buf_.size() - 1)]; }
+
+    void push_back(const T& value)
+    {
+        if (size_ == buf_.size()) grow();
+        buf_[(head_ + size_) & (buf_.size() - 1)] = value;
+        ++size_;
+    }
+
+    void pop_front()
+    {
+        head_ = (head_ + 1) & (buf_.size() - 1);
+        --size_;
+    }
+
+    void clear()
+    {
+        head_ = 0;
+        size_ = 0;
+    }
+
+private:
+    void grow()
+    {
+        std::vector<T> bigger(buf_.empty() ? 8 : buf_.size() * 2);
+        NETSIM_COUNT(Allocations, 1);
+        for (std::size_t i = 0; i < size_; ++i) {
+            bigger[i] = std::move(buf_[(head_ + i) & (buf_.size() - 1)]);
+        }
+        buf_.swap(bigger);
+        head_ = 0;
+    }
+
+    std::vector<T> buf_;
+    std::size_t    head_ = 0;
+    std::size_t    size_ = 0;
+};
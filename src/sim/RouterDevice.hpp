@@ -0,0 +1,77 @@
+#pragma once
+#include "Device.hpp"
+#include "Snapshot.hpp"
+#include <string>
+
+// A home gateway that answers what reaches it: DNS queries after 50 ms,
+// HTTPS requests with a 50 kB response after 100 ms, each addressed to the
+// request's originator and routed there, however many hops away it is.
+// Any number of routers can run in one network; nobody has to poll them.
+class RouterDevice : public Device
+{
+public:
+    RouterDevice(int id, NetworkScope scope, const std::string& ip)
+        : Device(id, scope, ipv4(ip)) {}
+    RouterDevice(int id, NetworkScope scope, IpAddress ip)
+        : Device(id, scope, ip) {}
+
+    void onPacketReceived(const Packet& pkt) override
+    {
+        if (pkt.dstPort == 53 && pkt.app == ApplicationProtocol::DNS) {
+            send(reply(pkt, 120, ip_, ApplicationProtocol::DNS, TransportProtocol::UDP), 0.050);
+        } else if (pkt.dstPort == 443 && pkt.app == ApplicationProtocol::HTTPS) {
+            send(reply(pkt, 50000, makeIpv4(142, 250, 0, 0), ApplicationProtocol::HTTPS,
+                       TransportProtocol::TCP), 0.100);
+        }
+    }
+
+    // replies sent so far
+    std::uint64_t packetsSent() const { return nextPacketId_ - 1; }
+
+    DeviceKind kind() const override { return DeviceKind::Router; }
+
+    void saveState(SnapshotWriter& out) const override
+    {
+        out.put(ip_);
+        out.put(nextPacketId_);
+    }
+
+    void restoreState(SnapshotReader& in) override
+    {
+        in.get(ip_);
+        in.get(nextPacketId_);
+    }
+
+    DeviceInfo info() const override
+    {
+        return DeviceInfo{
+            "home-router",
+            "ISP",
+            "Router",
+            formatIpv4(ip_),
+            "203.0.113.1",
+            "00:11:22:33:44:55"
+        };
+    }
+
+private:
+    Packet reply(const Packet& req, std::uint32_t size, IpAddress srcIp,
+                 ApplicationProtocol app, TransportProtocol transport)
+    {
+        Packet p;
+        p.id        = nextPacketId_++;
+        p.srcNodeId = id_;
+        p.dstNodeId = req.srcNodeId;
+        p.sizeBytes = size;
+        p.createdAt = 0.0; // stamped by the simulation
+        p.srcIp     = srcIp;
+        p.dstIp     = req.srcIp;
+        p.srcPort   = req.dstPort;
+        p.dstPort   = req.srcPort;
+        p.transport = transport;
+        p.app       = app;
+        return p;
+    }
+
+    std::uint64_t nextPacketId_ = 1;
+};
@@ -0,0 +1,218 @@
+#include "Routing.hpp"
+#include "Network.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+static constexpr double kUnreachable = std::numeric_limits<double>::infinity();
+
+void Routing::setMetric(RouteMetric metric)
+{
+    if (metric == metric_) return;
+    metric_ = metric;
+    trees_.clear();
+}
+
+double Routing::cost(const Link& link) const
+{
+    if (metric_ == RouteMetric::Bandwidth) {
+        return link.bandwidthMbps > 0.0 ? 1000.0 / link.bandwidthMbps : kUnreachable;
+    }
+    return link.latencyMs;
+}
+
+void Routing::fit(Tree& tree) const
+{
+    const std::size_t n = net_.nodeCapacity();
+    if (tree.dist.size() >= n) return;
+    tree.dist.resize(n, kUnreachable);
+    tree.next.resize(n, -1);
+    tree.via.resize(n, -1);
+}
+
+void Routing::settle(Tree& tree, std::vector<std::pair<double, int>>& frontier)
+{
+    using Entry = std::pair<double, int>;
+    auto later = std::greater<Entry>();
+    std::make_heap(frontier.begin(), frontier.end(), later);
+
+    while (!frontier.empty()) {
+        std::pop_heap(frontier.begin(), frontier.end(), later);
+        auto [d, x] = frontier.back();
+        frontier.pop_back();
+        if (d > tree.dist[x]) continue; // stale entry
+
+        for (int lid : net_.linksOf(x)) {
+            const Link* link = net_.getLink(lid);
+            if (!link || !link->up) continue;
+            int y = link->nodeA == x ? link->nodeB : link->nodeA;
+            double nd = d + cost(*link);
+            if (nd < tree.dist[y]) {
+                tree.dist[y] = nd;
+                tree.next[y] = x;
+                tree.via[y]  = lid;
+                frontier.emplace_back(nd, y);
+                std::push_heap(frontier.begin(), frontier.end(), later);
+            }
+        }
+    }
+}
+
+void Routing::setTreeLimit(std::size_t limit)
+{
+    treeLimit_ = std::max<std::size_t>(limit, 1);
+    while (trees_.size() > treeLimit_) evictOldest();
+}
+
+void Routing::evictOldest()
+{
+    auto oldest = std::min_element(trees_.begin(), trees_.end(), [](const auto& a, const auto& b) {
+        return a.second.lastUse < b.second.lastUse;
+    });
+    if (oldest != trees_.end()) trees_.erase(oldest);
+}
+
+Routing::Tree& Routing::treeFor(int dst)
+{
+    auto it = trees_.find(dst);
+    if (it != trees_.end()) {
+        fit(it->second);
+        it->second.lastUse = ++uses_;
+        return it->second;
+    }
+
+    // a miss already costs a Dijkstra, so a linear scan for the victim is fine
+    if (trees_.size() >= treeLimit_) evictOldest();
+    Tree& tree = trees_[dst];
+    tree.lastUse = ++uses_;
+    fit(tree);
+    tree.dist[dst] = 0.0;
+    tree.next[dst] = dst;
+    frontier_.assign(1, { 0.0, dst });
+    settle(tree, frontier_);
+    return tree;
+}
+
+Routing::Hop Routing::hop(int from, int dst)
+{
+    if (from == dst) return Hop{ dst, -1, 0.0 };
+
+    const std::vector<int>& links = net_.linksOf(dst);
+    if (links.size() == 1) {
+        // a stub: every path ends with its one link, so route to the far end
+        const Link* link = net_.getLink(links.front());
+        if (!link || !link->up) return Hop{ -1, -1, kUnreachable };
+        const int uplink = link->nodeA == dst ? link->nodeB : link->nodeA;
+        if (from == uplink) return Hop{ dst, link->id, cost(*link) };
+        const Tree& tree = treeFor(uplink);
+        return Hop{ tree.next[from], tree.via[from], tree.dist[from] + cost(*link) };
+    }
+    const Tree& tree = treeFor(dst);
+    return Hop{ tree.next[from], tree.via[from], tree.dist[from] };
+}
+
+int Routing::nextHop(int from, int dst)
+{
+    const int n = static_cast<int>(net_.nodeCapacity());
+    if (from < 0 || dst < 0 || from >= n || dst >= n) return -1;
+    return hop(from, dst).next;
+}
+
+int Routing::nextLink(int from, int dst)
+{
+    const int n = static_cast<int>(net_.nodeCapacity());
+    if (from < 0 || dst < 0 || from >= n || dst >= n) return -1;
+    return hop(from, dst).via;
+}
+
+double Routing::distance(int from, int dst)
+{
+    const int n = static_cast<int>(net_.nodeCapacity());
+    if (from < 0 || dst < 0 || from >= n || dst >= n) return kUnreachable;
+    return hop(from, dst).dist;
+}
+
+void Routing::onLinkAdded(const Link& link)
+{
+    if (!link.up) return;
+    const double c = cost(link);
+    for (auto& [dst, tree] : trees_) {
+        fit(tree);
+        frontier_.clear();
+        // the new link can only shorten paths, starting at one of its ends
+        if (tree.dist[link.nodeA] + c < tree.dist[link.nodeB]) {
+            tree.dist[link.nodeB] = tree.dist[link.nodeA] + c;
+            tree.next[link.nodeB] = link.nodeA;
+            tree.via[link.nodeB]  = link.id;
+            frontier_.emplace_back(tree.dist[link.nodeB], link.nodeB);
+        } else if (tree.dist[link.nodeB] + c < tree.dist[link.nodeA]) {
+            tree.dist[link.nodeA] = tree.dist[link.nodeB] + c;
+            tree.next[link.nodeA] = link.nodeB;
+            tree.via[link.nodeA]  = link.id;
+            frontier_.emplace_back(tree.dist[link.nodeA], link.nodeA);
+        }
+        if (!frontier_.empty()) settle(tree, frontier_);
+    }
+}
+
+void Routing::onLinkRemoved(const Link& link)
+{
+    if (inSubtree_.size() < net_.nodeCapacity()) inSubtree_.resize(net_.nodeCapacity(), 0);
+
+    for (auto& [dst, tree] : trees_) {
+        fit(tree);
+
+        // only a tree link matters; cut below whichever end hung off it
+        int root;
+        if (tree.via[link.nodeA] == link.id)      root = link.nodeA;
+        else if (tree.via[link.nodeB] == link.id) root = link.nodeB;
+        else continue;
+
+        // nodes routing through root: children are neighbours whose next hop is the parent
+        subtree_.assign(1, root);
+        inSubtree_[root] = 1;
+        for (std::size_t k = 0; k < subtree_.size(); ++k) {
+            int x = subtree_[k];
+            for (int lid : net_.linksOf(x)) {
+                const Link* l = net_.getLink(lid);
+                if (!l) continue;
+                int y = l->nodeA == x ? l->nodeB : l->nodeA;
+                if (!inSubtree_[y] && tree.via[y] == lid && tree.next[y] == x) {
+                    inSubtree_[y] = 1;
+                    subtree_.push_back(y);
+                }
+            }
+        }
+        for (int x : subtree_) {
+            tree.dist[x] = kUnreachable;
+            tree.next[x] = -1;
+            tree.via[x]  = -1;
+        }
+
+        // re-enter the subtree from its best neighbour outside it
+        frontier_.clear();
+        for (int x : subtree_) {
+            for (int lid : net_.linksOf(x)) {
+                const Link* l = net_.getLink(lid);
+                if (!l || !l->up) continue;
+                int y = l->nodeA == x ? l->nodeB : l->nodeA;
+                if (inSubtree_[y]) continue;
+                double nd = tree.dist[y] + cost(*l);
+                if (nd < tree.dist[x]) {
+                    tree.dist[x] = nd;
+                    tree.next[x] = y;
+                    tree.via[x]  = lid;
+                }
+            }
+            if (tree.next[x] != -1) frontier_.emplace_back(tree.dist[x], x);
+        }
+        for (int x : subtree_) inSubtree_[x] = 0;
+
+        settle(tree, frontier_);
+    }
+}
+
+void Routing::onNodeRemoved(int id)
+{
+    trees_.erase(id);
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Network;
+struct Link;
+
+enum class RouteMetric : std::uint8_t
+{
+    Latency,  // sum of link latencies
+    Bandwidth // sum of 1000 / bandwidthMbps, i.e. 1 per 1 Gbit/s hop
+};
+
+// Shortest-path forwarding. Instead of all-pairs tables, each destination
+// gets one shortest-path tree (every node's next hop toward it), built on
+// first use and then repaired in place as the topology changes: a new link
+// only relaxes the nodes it brings closer, and losing a tree link only
+// re-roots the subtree that hung off it.
+//
+// A node with a single link (a host behind its router) gets no tree: the
+// way to it is the way to the far end of that link, plus the link. The
+// other trees are kept for the most recently used destinations only, at
+// most treeLimit() of them. A tree is 16 bytes per node id, so the cache
+// holds at most treeLimit() * 16 * nodeCapacity() bytes (64 trees at 50k
+// nodes: about 51 MB), and a topology change repairs at most that many.
+//
+// In a partitioned run each region routes over its own links; a remote
+// node is reachable only as the far end of its remote link.
+class Routing
+{
+public:
+    explicit Routing(const Network& net) : net_(net) {}
+
+    void        setMetric(RouteMetric metric);
+    RouteMetric metric() const { return metric_; }
+
+    // neighbour of `from` on a shortest path to dst, -1 if unreachable
+    int    nextHop(int from, int dst);
+    // id of the link that hop takes, -1 if unreachable or from == dst; with
+    // parallel links between two nodes, this is the one the path uses
+    int    nextLink(int from, int dst);
+    double distance(int from, int dst);
+
+    // topology hooks, called by Network after its own indexes are updated
+    void onLinkAdded(const Link& link);
+    void onLinkRemoved(const Link& link);
+    void onNodeRemoved(int id);
+
+    void        clear() { trees_.clear(); }
+    std::size_t cachedTrees() const { return trees_.size(); }
+    // evicts least recently used trees down to the new limit (at least 1)
+    void        setTreeLimit(std::size_t limit);
+    std::size_t treeLimit() const { return treeLimit_; }
+
+    static constexpr std::size_t kDefaultTreeLimit = 64;
+
+private:
+    struct Tree
+    {
+        std::vector<double> dist; // to the destination
+        std::vector<int>    next; // neighbour toward it, -1 if unreachable
+        std::vector<int>    via;  // link id used for that hop
+        std::uint64_t       lastUse = 0;
+    };
+
+    struct Hop
+    {
+        int    next;
+        int    via;
+        double dist;
+    };
+
+    // the first hop from `from` toward dst; ids already range-checked
+    Hop    hop(int from, int dst);
+    Tree&  treeFor(int dst);
+    void   evictOldest();
+    void   fit(Tree& tree) const;
+    double cost(const Link& link) const;
+    // Dijkstra from nodes whose dist was just lowered
+    void   settle(Tree& tree, std::vector<std::pair<double, int>>& frontier);
+
+    const Network&                net_;
+    RouteMetric                   metric_ = RouteMetric::Latency;
+    std::unordered_map<int, Tree> trees_;
+    std::size_t                   treeLimit_ = kDefaultTreeLimit;
+    std::uint64_t                 uses_      = 0; // stamps Tree::lastUse
+
+    // scratch for onLinkRemoved
+    std::vector<char>                   inSubtree_;
+    std::vector<int>                    subtree_;
+    std::vector<std::pair<double, int>> frontier_;
+};
@@ -0,0 +1,189 @@
+#include "Simulation.hpp"
+#include "Profiler.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <limits>
+
+void Simulation::schedulePacket(const Packet& pkt, int fromNode, int toNode, double sendAt,
+                                int linkId)
+{
+    std::uint32_t slot = packets_.acquire(ScheduledPacket{ pkt, fromNode, toNode, linkId });
+    events_.push(sendAt, EventKind::SendPacket, slot);
+}
+
+void Simulation::scheduleDelivery(const Packet& pkt, int toNode, double arriveAt)
+{
+    std::uint32_t slot = packets_.acquire(ScheduledPacket{ pkt, -1, toNode, -1 });
+    events_.push(arriveAt, EventKind::Deliver, slot);
+}
+
+Simulation::TimerId Simulation::scheduleTimer(double at, TimerFn fn)
+{
+    std::uint32_t slot = timers_.acquire(std::move(fn));
+    return events_.push(at, EventKind::Timer, slot);
+}
+
+double Simulation::nextEventTime() const
+{
+    if (events_.empty()) return std::numeric_limits<double>::infinity();
+    return events_.top().time;
+}
+
+void Simulation::dispatch(const Event& ev)
+{
+    switch (ev.kind) {
+    // payloads stay put while the handler runs; the slot is only released
+    // afterwards so anything scheduled from inside gets a different one
+    case EventKind::SendPacket: {
+        const ScheduledPacket& sp = packets_[ev.slot];
+        if (sp.linkId >= 0) network_.transmit(sp.pkt, sp.linkId, sp.fromNode, sp.toNode);
+        else                network_.spawnPacketOnLink(sp.pkt, sp.fromNode, sp.toNode);
+        packets_.release(ev.slot);
+        break;
+    }
+    case EventKind::Deliver: {
+        const ScheduledPacket& sp = packets_[ev.slot];
+        network_.deliver(sp.pkt, sp.toNode);
+        packets_.release(ev.slot);
+        break;
+    }
+    case EventKind::Timer: {
+        TimerFn& fn = timers_[ev.slot];
+        if (!unbound_.empty()) unbound_.erase(ev.seq);
+        if (fn) {
+            NETSIM_PROFILE_SCOPE(Traffic);
+            fn(currentTime_);
+        }
+        fn = nullptr; // drop captures now rather than on reuse
+        timers_.release(ev.slot);
+        break;
+    }
+    }
+}
+
+void Simulation::fireEventsUntil(double until)
+{
+    while (!events_.empty() && events_.top().time <= until) {
+        Event ev = events_.pop();
+        currentTime_ = std::max(currentTime_, ev.time);
+        network_.setClock(currentTime_);
+        dispatch(ev);
+        ++eventsProcessed_;
+        NETSIM_COUNT(EventsProcessed, 1);
+    }
+}
+
+void Simulation::step(double dt)
+{
+    NETSIM_PROFILE_SCOPE(Step);
+    const double target = currentTime_ + dt;
+
+    // let the devices that asked to wake by now think
+    {
+        NETSIM_PROFILE_SCOPE(DeviceTick);
+        network_.tickDevices(target);
+    }
+    // fire due events in timestamp order
+    {
+        NETSIM_PROFILE_SCOPE(Events);
+        fireEventsUntil(target);
+    }
+    currentTime_ = target;
+
+    // move packets along links
+    network_.updatePackets(dt);
+
+    // what devices sent this step leaves from its end
+    {
+        NETSIM_PROFILE_SCOPE(Outbox);
+        std::vector<Network::Outgoing>& outbox = network_.routeOutbox();
+        for (Network::Outgoing& out : outbox) {
+            out.pkt.createdAt = currentTime_;
+            schedulePacket(out.pkt, out.fromNode, out.nextHop, currentTime_ + out.delay, out.linkId);
+        }
+        outbox.clear();
+    }
+    ++steps_;
+}
+
+void Simulation::run(double until, double maxDt)
+{
+    while (currentTime_ < until) {
+        double dt = std::min(maxDt, until - currentTime_);
+        if (network_.inFlight().empty()) {
+            // nothing moving: skip the idle gap in one go
+            const double next = std::min(nextEventTime(), network_.nextWakeup());
+            dt = std::max(dt, std::min(next, until) - currentTime_);
+        }
+        step(dt);
+    }
+}
+
+void Simulation::save(SnapshotWriter& out) const
+{
+    out.put(currentTime_);
+    out.put(eventsProcessed_);
+    out.put(steps_);
+    out.put(events_.nextSeq());
+    // heap order, so the restored queue is the same heap
+    const std::vector<Event>& heap = events_.events();
+    out.put<std::uint64_t>(heap.size());
+    for (const Event& ev : heap) {
+        out.put(ev.time);
+        out.put(ev.seq);
+        out.put(ev.kind);
+        if (ev.kind != EventKind::Timer) out.put(packets_[ev.slot]);
+    }
+}
+
+bool Simulation::restore(SnapshotReader& in, std::string& error)
+{
+    if (!events_.empty()) {
+        error = "restore needs a simulation with nothing scheduled";
+        return false;
+    }
+    in.get(currentTime_);
+    in.get(eventsProcessed_);
+    in.get(steps_);
+    const std::uint64_t nextSeq = in.get<std::uint64_t>();
+
+    const std::size_t n = in.getCount(sizeof(double) + sizeof(std::uint64_t) + 1);
+    std::vector<Event> heap;
+    heap.reserve(n);
+    for (std::size_t i = 0; i < n && in.ok(); ++i) {
+        Event ev;
+        in.get(ev.time);
+        in.get(ev.seq);
+        in.get(ev.kind);
+        switch (ev.kind) {
+        case EventKind::SendPacket:
+        case EventKind::Deliver:
+            ev.slot = packets_.acquire(in.get<ScheduledPacket>());
+            break;
+        case EventKind::Timer:
+            ev.slot = timers_.acquire(nullptr);
+            unbound_[ev.seq] = ev.slot;
+            break;
+        default:
+            in.fail();
+            break;
+        }
+        heap.push_back(ev);
+    }
+    if (!in.ok()) {
+        error = "simulation section is malformed or truncated";
+        return false;
+    }
+    events_.assign(std::move(heap), nextSeq);
+    network_.setClock(currentTime_);
+    return true;
+}
+
+bool Simulation::bindTimer(TimerId id, TimerFn fn)
+{
+    auto it = unbound_.find(id);
+    if (it == unbound_.end()) return false;
+    timers_[it->second] = std::move(fn);
+    unbound_.erase(it);
+    return true;
+}
@@ -1,23 +1,75 @@
 #pragma once
 #include "Network.hpp"
+#include "EventQueue.hpp"
+#include "Pool.hpp"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-class Simulation 
+struct ScheduledPacket
+{
+    Packet pkt;
+    int    fromNode;
+    int    toNode;
+    int    linkId; // -1: any link between the two
+};
+
+class Simulation
 {
 public:
+    using TimerFn = std::function<void(double now)>;
+    using TimerId = std::uint64_t;
+
     explicit Simulation(Network& net)
         : network_(net) {}
-    void step(double dt) 
-    {
-        currentTime_ += dt;
-        // let devices think
-        for (auto& dev : network_.devices()) {
-            dev->tick(currentTime_);
-        }
-        // move packets along links
-        network_.updatePackets(dt);
-    }
+
+    // advance the clock by dt, firing every event that falls due on the way
+    void step(double dt);
+
+    // run until `until`; steps by at most maxDt while packets are on the wire
+    // and jumps straight to the next event while the links are idle
+    void run(double until, double maxDt);
+
+    // hand pkt to spawnPacketOnLink(fromNode, toNode) at sendAt, or to
+    // Network::transmit on linkId when routing has picked one
+    void schedulePacket(const Packet& pkt, int fromNode, int toNode, double sendAt,
+                        int linkId = -1);
+    // hand pkt to Network::deliver(toNode) at arriveAt, e.g. after crossing
+    // from another partition
+    void scheduleDelivery(const Packet& pkt, int toNode, double arriveAt);
+    // call fn(now) at time `at`; re-arm from inside fn for periodic timers.
+    // The id is what an owner saves to re-bind the timer after a restore.
+    TimerId scheduleTimer(double at, TimerFn fn);
+
+    // Clock and pending events. Timers are saved without their callbacks:
+    // after restore() each is pending but unbound, and does nothing when it
+    // fires unless its owner has called bindTimer(). restore() needs a
+    // simulation with nothing scheduled.
+    void save(SnapshotWriter& out) const;
+    bool restore(SnapshotReader& in, std::string& error);
+    bool bindTimer(TimerId id, TimerFn fn);
+    std::size_t unboundTimers() const { return unbound_.size(); }
+
     double time() const { return currentTime_; }
+    double nextEventTime() const;
+    std::size_t pendingEvents() const { return events_.size(); }
+    std::uint64_t eventsProcessed() const { return eventsProcessed_; }
+    std::uint64_t steps() const { return steps_; }
+
 private:
-    Network& network_;
-    double currentTime_ = 0.0;
+    void fireEventsUntil(double until);
+    void dispatch(const Event& ev);
+
+    Network&   network_;
+    double     currentTime_ = 0.0;
+    EventQueue events_;
+
+    std::uint64_t eventsProcessed_ = 0;
+    std::uint64_t steps_           = 0;
+
+    // event payloads; slab storage never moves, so dispatch works in place
+    SlabPool<ScheduledPacket> packets_;
+    SlabPool<TimerFn>         timers_;
+    std::unordered_map<TimerId, std::uint32_t> unbound_; // restored timers -> slot
 };
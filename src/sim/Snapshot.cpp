@@ -0,0 +1,121 @@
+#include "Snapshot.hpp"
+#include "HomeDevice.hpp"
+#include "IoTDevice.hpp"
+#include "RouterDevice.hpp"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static constexpr char          kMagic[8] = { 'N', 'S', 'S', 'N', 'A', 'P', '\0', '\1' };
+static constexpr std::uint32_t kVersion  = 1;
+
+struct SnapshotHeader
+{
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t bytes;
+};
+
+bool SnapshotWriter::writeFile(const std::string& path, std::string& error) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot create";
+        return false;
+    }
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = kVersion;
+    h.bytes   = bytes_.size();
+    out.write(reinterpret_cast<const char*>(&h), sizeof h);
+    out.write(reinterpret_cast<const char*>(bytes_.data()), static_cast<std::streamsize>(bytes_.size()));
+    if (!out.flush()) {
+        error = "write failed";
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotReader::readFile(const std::string& path, std::string& error)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open";
+        return false;
+    }
+    SnapshotHeader h{};
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof h) ||
+        std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 || h.version != kVersion) {
+        error = "not a version 1 snapshot";
+        return false;
+    }
+    owned_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (owned_.size() != h.bytes) {
+        error = "snapshot is truncated";
+        return false;
+    }
+    pos_ = owned_.data();
+    end_ = pos_ + owned_.size();
+    ok_  = true;
+    return true;
+}
+
+void saveDevice(SnapshotWriter& out, const Device& dev)
+{
+    out.put(dev.kind());
+    out.put<std::int32_t>(dev.id());
+    out.put(dev.scope());
+    dev.saveState(out);
+}
+
+std::unique_ptr<Device> restoreDevice(SnapshotReader& in)
+{
+    const DeviceKind   kind  = in.get<DeviceKind>();
+    const int          id    = in.get<std::int32_t>();
+    const NetworkScope scope = in.get<NetworkScope>();
+    if (!in.ok()) return nullptr;
+
+    std::unique_ptr<Device> dev;
+    switch (kind) {
+    case DeviceKind::Router: dev = std::make_unique<RouterDevice>(id, scope, IpAddress(0)); break;
+    case DeviceKind::Home:   dev = std::make_unique<HomeDevice>(id, scope, IpAddress(0), ""); break;
+    case DeviceKind::IoT:    dev = std::make_unique<IoTDevice>(id, scope); break;
+    default:
+        in.fail();
+        return nullptr;
+    }
+    dev->restoreState(in);
+    return in.ok() ? std::move(dev) : nullptr;
+}
+
+std::size_t forkRuns(std::size_t count, const std::function<int(std::size_t index)>& run)
+{
+    std::cout.flush();
+    std::cerr.flush();
+
+    std::size_t failed = 0;
+    std::vector<pid_t> children;
+    for (std::size_t i = 0; i < count; ++i) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            int status = run(i);
+            std::cout.flush();
+            std::cerr.flush();
+            ::_exit(status);
+        }
+        if (pid < 0) ++failed;
+        else children.push_back(pid);
+    }
+    for (pid_t pid : children) {
+        int status = 0;
+        if (::waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++failed;
+        }
+    }
+    return failed;
+}
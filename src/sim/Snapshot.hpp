@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class Device;
+
+// Binary snapshots of a running simulation. Each component writes its own
+// state into a SnapshotWriter and reads it back, in the same order, from a
+// SnapshotReader; the file is those bytes behind a short header. Values are
+// stored in native byte order and layout, so a snapshot is meant to be
+// restored by the same build on the same kind of machine.
+//
+// The pieces, in the order a whole run is saved:
+//   Network::save      devices, links and their queues, packets in flight
+//   Simulation::save   clock and pending events; timers keep their ids but
+//                      not their callbacks, which their owners re-bind
+//   owners' save       e.g. HomeScenario, which re-binds its traffic timers
+//                      on restore
+//
+// Restoring into a fresh Network and Simulation and then calling the
+// owners' restore continues the run exactly where it was saved.
+
+class SnapshotWriter
+{
+public:
+    template <typename T>
+    void put(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "put() copies bytes");
+        const auto* p = reinterpret_cast<const std::uint8_t*>(&value);
+        bytes_.insert(bytes_.end(), p, p + sizeof(T));
+    }
+
+    template <typename T>
+    void putArray(const T* values, std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "putArray() copies bytes");
+        put<std::uint64_t>(count);
+        const auto* p = reinterpret_cast<const std::uint8_t*>(values);
+        bytes_.insert(bytes_.end(), p, p + count * sizeof(T));
+    }
+
+    template <typename T>
+    void putVector(const std::vector<T>& values) { putArray(values.data(), values.size()); }
+
+    void putString(const std::string& s) { putArray(s.data(), s.size()); }
+
+    const std::vector<std::uint8_t>& bytes() const { return bytes_; }
+
+    // header plus bytes(); false with a reason in `error`
+    bool writeFile(const std::string& path, std::string& error) const;
+
+private:
+    std::vector<std::uint8_t> bytes_;
+};
+
+// Reads back what a SnapshotWriter wrote. A read past the end, or a count
+// that does not fit what is left, marks the reader failed and yields
+// zeroes from then on; check ok() once a section has been read.
+class SnapshotReader
+{
+public:
+    SnapshotReader() = default;
+    SnapshotReader(const std::uint8_t* data, std::size_t size) : pos_(data), end_(data + size) {}
+    explicit SnapshotReader(const std::vector<std::uint8_t>& bytes)
+        : SnapshotReader(bytes.data(), bytes.size()) {}
+
+    // loads a file written by SnapshotWriter::writeFile
+    bool readFile(const std::string& path, std::string& error);
+
+    template <typename T>
+    T get()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "get() copies bytes");
+        T value{};
+        if (take(sizeof(T))) std::memcpy(&value, pos_ - sizeof(T), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void get(T& value) { value = get<T>(); }
+
+    template <typename T>
+    void getVector(std::vector<T>& out)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "getVector() copies bytes");
+        const std::uint64_t n = get<std::uint64_t>();
+        out.clear();
+        if (!ok_ || n > static_cast<std::uint64_t>(end_ - pos_) / sizeof(T)) {
+            fail();
+            return;
+        }
+        out.resize(static_cast<std::size_t>(n));
+        if (n) std::memcpy(out.data(), pos_, n * sizeof(T));
+        pos_ += n * sizeof(T);
+    }
+
+    std::string getString()
+    {
+        std::vector<char> chars;
+        getVector(chars);
+        return std::string(chars.begin(), chars.end());
+    }
+
+    // a count of records still to be read; fails if even `minBytes` each
+    // would not fit in what is left
+    std::size_t getCount(std::size_t minBytes)
+    {
+        const std::uint64_t n = get<std::uint64_t>();
+        if (!ok_ || (minBytes && n > static_cast<std::uint64_t>(end_ - pos_) / minBytes)) {
+            fail();
+            return 0;
+        }
+        return static_cast<std::size_t>(n);
+    }
+
+    void fail() { ok_ = false; pos_ = end_; }
+    bool ok() const { return ok_; }
+    bool atEnd() const { return pos_ == end_; }
+
+private:
+    bool take(std::size_t n)
+    {
+        if (!ok_ || static_cast<std::size_t>(end_ - pos_) < n) {
+            fail();
+            return false;
+        }
+        pos_ += n;
+        return true;
+    }
+
+    std::vector<std::uint8_t> owned_; // file contents, when read from one
+    const std::uint8_t*       pos_ = nullptr;
+    const std::uint8_t*       end_ = nullptr;
+    bool                      ok_  = true;
+};
+
+// a bool is one byte written as 0 or 1; anything else is corrupt, and
+// copying it into a bool unchecked would be undefined
+template <>
+inline bool SnapshotReader::get<bool>()
+{
+    const std::uint8_t byte = get<std::uint8_t>();
+    if (byte > 1) fail();
+    return byte == 1;
+}
+
+// A device as kind, id, scope and its own state, rebuilt by kind on
+// restore; nullptr (reader failed) for a kind this build cannot create.
+// Device::kind() must not be DeviceKind::Other when saving.
+void                    saveDevice(SnapshotWriter& out, const Device& dev);
+std::unique_ptr<Device> restoreDevice(SnapshotReader& in);
+
+// Copy-on-write what-if runs: fork `count` children of this process, each
+// starting from its current state and calling run(index); a child exits
+// with run's return value. Memory is shared until a child writes to it,
+// so forking a warmed-up simulation costs page faults, not a rebuild.
+// Only the calling thread exists in a child: stop worker and writer
+// threads first. Returns how many children failed or could not start.
+std::size_t forkRuns(std::size_t count, const std::function<int(std::size_t index)>& run);
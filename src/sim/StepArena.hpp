@@ -0,0 +1,78 @@
+#pragma once
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Bump allocator for data that only lives for one simulation step.
+// Allocation is a pointer bump, nothing is freed individually, and reset()
+// makes the whole arena reusable. If a step overflowed into extra blocks,
+// reset() folds them into one block big enough for the largest step so far,
+// padding included, so a steady workload settles on a single block and
+// stops touching the heap.
+class StepArena
+{
+public:
+    explicit StepArena(std::size_t blockBytes = 64 * 1024)
+        : blockBytes_(blockBytes) {}
+
+    void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t))
+    {
+        std::size_t offset = (used_ + align - 1) & ~(align - 1);
+        if (blocks_.empty() || offset + bytes > blocks_.back().size) {
+            addBlock(bytes + align);
+            offset = (used_ + align - 1) & ~(align - 1);
+        }
+        used_ = offset + bytes;
+        // as laid out in one block, which is what reset() folds into
+        total_ = ((total_ + align - 1) & ~(align - 1)) + bytes;
+        peak_  = std::max(peak_, total_);
+        return blocks_.back().data.get() + offset;
+    }
+
+    // uninitialised storage for n objects of T; T must not need destruction
+    template <typename T>
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void reset()
+    {
+        if (blocks_.size() > 1) {
+            std::size_t want = std::max(blockBytes_, peak_);
+            blocks_.clear();
+            blocks_.push_back(Block{ std::unique_ptr<std::byte[]>(new std::byte[want]), want });
+            NETSIM_COUNT(Allocations, 1);
+        }
+        used_  = 0;
+        total_ = 0;
+    }
+
+    std::size_t bytesUsed() const { return total_; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t                  size;
+    };
+
+    void addBlock(std::size_t atLeast)
+    {
+        std::size_t size = std::max(blockBytes_, atLeast);
+        // left uninitialised: callers construct what they put there
+        blocks_.push_back(Block{ std::unique_ptr<std::byte[]>(new std::byte[size]), size });
+        NETSIM_COUNT(Allocations, 1);
+        used_ = 0;
+    }
+
+    std::vector<Block> blocks_;
+    std::size_t        blockBytes_;
+    std::size_t        used_  = 0; // in the current block
+    std::size_t        total_ = 0; // this step, all blocks, with padding
+    std::size_t        peak_  = 0; // largest total_ seen
+};
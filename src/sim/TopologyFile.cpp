@@ -0,0 +1,395 @@
+#include "TopologyFile.hpp"
+#include "HomeDevice.hpp"
+#include "RouterDevice.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char          kMagic[8] = { 'N', 'S', 'T', 'O', 'P', 'O', '\0', '\1' };
+static constexpr std::uint32_t kVersion  = 1;
+
+// ---- binary ----------------------------------------------------------------
+
+bool MappedTopology::open(const std::string& path, std::string& error)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open";
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(TopologyHeader))) {
+        ::close(fd);
+        error = "too short for a topology header";
+        return false;
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+    if (map == MAP_FAILED) {
+        size_ = 0;
+        error = "mmap failed";
+        return false;
+    }
+    map_ = map;
+    ::madvise(map_, size_, MADV_SEQUENTIAL);
+
+    const auto* base = static_cast<const char*>(map_);
+    TopologyHeader h;
+    std::memcpy(&h, base, sizeof h);
+    if (std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 || h.version != kVersion) {
+        close();
+        error = "not a version 1 binary topology";
+        return false;
+    }
+    // counts are bounded by the file size before they are multiplied out
+    const std::size_t body = size_ - sizeof(TopologyHeader);
+    if (h.deviceCount > body / sizeof(TopologyDevice) || h.linkCount > body / sizeof(TopologyLink) ||
+        h.nameBytes > body ||
+        sizeof(TopologyHeader) + h.deviceCount * sizeof(TopologyDevice) +
+            h.linkCount * sizeof(TopologyLink) + h.nameBytes != size_) {
+        close();
+        error = "record counts do not match the file size";
+        return false;
+    }
+
+    devices_     = reinterpret_cast<const TopologyDevice*>(base + sizeof(TopologyHeader));
+    deviceCount_ = h.deviceCount;
+    links_       = reinterpret_cast<const TopologyLink*>(devices_ + deviceCount_);
+    linkCount_   = static_cast<std::size_t>(h.linkCount);
+    names_       = reinterpret_cast<const char*>(links_ + linkCount_);
+    nameBytes_   = static_cast<std::size_t>(h.nameBytes);
+    return true;
+}
+
+void MappedTopology::close()
+{
+    if (map_) ::munmap(map_, size_);
+    map_ = nullptr;
+    size_ = 0;
+    devices_ = nullptr;
+    links_ = nullptr;
+    names_ = nullptr;
+    deviceCount_ = linkCount_ = nameBytes_ = 0;
+}
+
+bool isBinaryTopology(const std::string& path)
+{
+    char magic[sizeof kMagic] = {};
+    std::ifstream in(path, std::ios::binary);
+    return in.read(magic, sizeof magic) && std::memcmp(magic, kMagic, sizeof kMagic) == 0;
+}
+
+bool writeTopologyBinary(const std::string& path, const Topology& topo, std::string& error)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot open for writing";
+        return false;
+    }
+    TopologyHeader h;
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version     = kVersion;
+    h.deviceCount = static_cast<std::uint32_t>(topo.devices.size());
+    h.linkCount   = topo.links.size();
+    h.nameBytes   = topo.names.size();
+    out.write(reinterpret_cast<const char*>(&h), sizeof h);
+    out.write(reinterpret_cast<const char*>(topo.devices.data()),
+              static_cast<std::streamsize>(topo.devices.size() * sizeof(TopologyDevice)));
+    out.write(reinterpret_cast<const char*>(topo.links.data()),
+              static_cast<std::streamsize>(topo.links.size() * sizeof(TopologyLink)));
+    out.write(topo.names.data(), static_cast<std::streamsize>(topo.names.size()));
+    if (!out.flush()) {
+        error = "write failed";
+        return false;
+    }
+    return true;
+}
+
+// ---- text ------------------------------------------------------------------
+
+namespace {
+
+// cursor over one line; tokens end at whitespace, the line ends at '#'
+struct LineReader
+{
+    const char* p;
+    const char* end;
+
+    void skipSpace()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p < end && *p == '#') p = end;
+    }
+    bool atEnd()
+    {
+        skipSpace();
+        return p == end;
+    }
+    std::string_view token()
+    {
+        skipSpace();
+        const char* b = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '#') ++p;
+        return std::string_view(b, static_cast<std::size_t>(p - b));
+    }
+    // what is left, without the comment and trailing blanks
+    std::string_view rest()
+    {
+        skipSpace();
+        const char* b = p;
+        const char* e = b;
+        while (p < end && *p != '#') {
+            if (*p != ' ' && *p != '\t' && *p != '\r') e = p + 1;
+            ++p;
+        }
+        return std::string_view(b, static_cast<std::size_t>(e - b));
+    }
+    template <typename T>
+    bool number(T& out)
+    {
+        std::string_view t = token();
+        auto r = std::from_chars(t.data(), t.data() + t.size(), out);
+        return !t.empty() && r.ec == std::errc() && r.ptr == t.data() + t.size();
+    }
+};
+
+bool parseScope(std::string_view s, std::uint8_t& out)
+{
+    if      (s == "local")      out = static_cast<std::uint8_t>(NetworkScope::Local);
+    else if (s == "enterprise") out = static_cast<std::uint8_t>(NetworkScope::Enterprise);
+    else if (s == "global")     out = static_cast<std::uint8_t>(NetworkScope::Global);
+    else return false;
+    return true;
+}
+
+const char* scopeName(std::uint8_t scope)
+{
+    switch (static_cast<NetworkScope>(scope)) {
+    case NetworkScope::Local:      return "local";
+    case NetworkScope::Enterprise: return "enterprise";
+    case NetworkScope::Global:     return "global";
+    }
+    return "local";
+}
+
+bool readWholeFile(const std::string& path, std::string& out)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    out.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    return static_cast<bool>(in.read(&out[0], static_cast<std::streamsize>(out.size())));
+}
+
+} // namespace
+
+bool readTopologyText(const std::string& path, Topology& out, std::string& error)
+{
+    std::string text;
+    if (!readWholeFile(path, text)) {
+        error = "cannot read";
+        return false;
+    }
+
+    Topology topo;
+    int lineNo = 0;
+    auto fail = [&](const char* why) {
+        error = "line " + std::to_string(lineNo) + ": " + why;
+        return false;
+    };
+
+    const char* p   = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+        if (!eol) eol = end;
+        LineReader line{ p, eol };
+        p = eol + 1;
+        ++lineNo;
+
+        std::string_view kind = line.token();
+        if (kind.empty()) continue;
+
+        if (kind == "device") {
+            TopologyDevice d{};
+            std::string_view type, scope, ip;
+            if (!line.number(d.id) || d.id < 0) return fail("device id must be a non-negative integer");
+            type  = line.token();
+            scope = line.token();
+            ip    = line.token();
+            if      (type == "router") d.kind = DeviceKind::Router;
+            else if (type == "home")   d.kind = DeviceKind::Home;
+            else return fail("device kind is router or home");
+            if (!parseScope(scope, d.scope)) return fail("scope is local, enterprise or global");
+            if (!parseIpv4(std::string(ip), d.ip)) return fail("malformed IPv4 address");
+
+            std::string_view name = line.rest();
+            if (name.size() > 0xffff) return fail("device name too long");
+            d.nameOffset = static_cast<std::uint32_t>(topo.names.size());
+            d.nameLength = static_cast<std::uint16_t>(name.size());
+            topo.names.append(name.data(), name.size());
+            topo.devices.push_back(d);
+        } else if (kind == "link") {
+            TopologyLink l{};
+            if (!line.number(l.a) || !line.number(l.b)) return fail("link endpoints must be device ids");
+            if (!line.number(l.bandwidthMbps) || l.bandwidthMbps <= 0.0) return fail("bandwidth must be positive");
+            if (!line.number(l.latencyMs) || l.latencyMs < 0.0) return fail("latency must not be negative");
+            if (!line.atEnd() && !line.number(l.bufferBytes)) return fail("buffer must be a byte count");
+            if (!line.atEnd()) return fail("unexpected text after link");
+            topo.links.push_back(l);
+        } else {
+            return fail("expected 'device' or 'link'");
+        }
+    }
+    out = std::move(topo);
+    return true;
+}
+
+bool writeTopologyText(const std::string& path, const Topology& topo, std::string& error)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        error = "cannot open for writing";
+        return false;
+    }
+    out << "# 40NetSim topology: " << topo.devices.size() << " devices, "
+        << topo.links.size() << " links\n";
+
+    // shortest round-trip form for the doubles, so text -> binary -> text is exact
+    char buf[160];
+    for (const auto& d : topo.devices) {
+        int n = std::snprintf(buf, sizeof buf, "device %d %s %s %s", d.id,
+                              d.kind == DeviceKind::Router ? "router" : "home",
+                              scopeName(d.scope), formatIpv4(d.ip).c_str());
+        out.write(buf, n);
+        if (d.nameLength) out << ' ' << std::string_view(topo.names.data() + d.nameOffset, d.nameLength);
+        out << '\n';
+    }
+    for (const auto& l : topo.links) {
+        char* p = buf;
+        char* e = buf + sizeof buf;
+        auto put = [&](auto v) { // a line is well under sizeof buf
+            if (p < e) *p++ = ' ';
+            p = std::to_chars(p, e, v).ptr;
+        };
+        std::memcpy(p, "link", 4);
+        p += 4;
+        put(l.a);
+        put(l.b);
+        put(l.bandwidthMbps);
+        put(l.latencyMs);
+        if (l.bufferBytes) put(l.bufferBytes);
+        if (p < e) *p++ = '\n';
+        out.write(buf, p - buf);
+    }
+    if (!out.flush()) {
+        error = "write failed";
+        return false;
+    }
+    return true;
+}
+
+bool readTopology(const std::string& path, Topology& out, std::string& error)
+{
+    if (!isBinaryTopology(path)) return readTopologyText(path, out, error);
+
+    MappedTopology map;
+    if (!map.open(path, error)) return false;
+    out.devices.assign(map.devices(), map.devices() + map.deviceCount());
+    out.links.assign(map.links(), map.links() + map.linkCount());
+    out.names.assign(map.names(), map.nameBytes());
+    return true;
+}
+
+// ---- loading ---------------------------------------------------------------
+
+bool loadTopology(Network& net, const TopologyDevice* devices, std::size_t deviceCount,
+                  const TopologyLink* links, std::size_t linkCount,
+                  const char* names, std::size_t nameBytes, std::string& error)
+{
+    // validate and size everything before touching the network
+    int maxId = -1;
+    for (std::size_t i = 0; i < deviceCount; ++i) {
+        const TopologyDevice& d = devices[i];
+        if (d.id < 0 || d.kind > DeviceKind::Home ||
+            d.scope > static_cast<std::uint8_t>(NetworkScope::Global) ||
+            static_cast<std::size_t>(d.nameOffset) + d.nameLength > nameBytes) {
+            error = "device record " + std::to_string(i) + " is malformed";
+            return false;
+        }
+        maxId = std::max(maxId, d.id);
+    }
+    const std::size_t nodes = static_cast<std::size_t>(maxId + 1);
+    std::vector<std::uint32_t> degree(nodes, 0);
+    for (std::size_t i = 0; i < linkCount; ++i) {
+        const TopologyLink& l = links[i];
+        if (l.a < 0 || l.b < 0 || static_cast<std::size_t>(l.a) >= nodes ||
+            static_cast<std::size_t>(l.b) >= nodes) {
+            error = "link " + std::to_string(i) + " names a device that is not in the file";
+            return false;
+        }
+        ++degree[l.a];
+        if (l.b != l.a) ++degree[l.b];
+    }
+
+    net.reserve(nodes, deviceCount, linkCount);
+    for (std::size_t id = 0; id < nodes; ++id) {
+        if (degree[id]) net.reserveLinksOf(static_cast<int>(id), degree[id]);
+    }
+
+    for (std::size_t i = 0; i < deviceCount; ++i) {
+        const TopologyDevice& d = devices[i];
+        const NetworkScope scope = static_cast<NetworkScope>(d.scope);
+        std::unique_ptr<Device> dev;
+        if (d.kind == DeviceKind::Router) {
+            dev = std::make_unique<RouterDevice>(d.id, scope, d.ip);
+        } else {
+            dev = std::make_unique<HomeDevice>(d.id, scope, d.ip,
+                                               std::string(names + d.nameOffset, d.nameLength));
+        }
+        if (net.addDevice(std::move(dev)) < 0) {
+            error = "device id " + std::to_string(d.id) + " is already taken";
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < linkCount; ++i) {
+        const TopologyLink& l = links[i];
+        int id = net.addLink(l.a, l.b, l.bandwidthMbps, l.latencyMs);
+        if (id < 0) {
+            error = "link " + std::to_string(i) + " names a device that is not in the file";
+            return false;
+        }
+        if (l.bufferBytes) net.setLinkBuffer(id, l.bufferBytes);
+    }
+    return true;
+}
+
+bool loadTopology(Network& net, const Topology& topo, std::string& error)
+{
+    return loadTopology(net, topo.devices.data(), topo.devices.size(),
+                        topo.links.data(), topo.links.size(),
+                        topo.names.data(), topo.names.size(), error);
+}
+
+bool loadTopologyFile(Network& net, const std::string& path, std::string& error)
+{
+    if (isBinaryTopology(path)) {
+        MappedTopology map;
+        return map.open(path, error) &&
+               loadTopology(net, map.devices(), map.deviceCount(), map.links(), map.linkCount(),
+                            map.names(), map.nameBytes(), error);
+    }
+    Topology topo;
+    return readTopologyText(path, topo, error) && loadTopology(net, topo, error);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "Network.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Topologies on disk, in two forms with the same content.
+//
+// Text (.topo), one record per line, '#' starts a comment:
+//
+//   device <id> <router|home> <local|enterprise|global> <ipv4> [name]
+//   link   <a> <b> <bandwidth Mbps> <latency ms> [buffer bytes]
+//
+// Binary (.topob): a TopologyHeader, then deviceCount TopologyDevice
+// records, linkCount TopologyLink records and the device names packed back
+// to back. Records are fixed size and 8-byte aligned in native byte order,
+// so a mapped file is used in place: loading is one pass over each array
+// with no parsing. Link ids follow file order when loaded into an empty
+// network.
+
+struct TopologyHeader
+{
+    char          magic[8];   // "NSTOPO\0\1"
+    std::uint32_t version;
+    std::uint32_t deviceCount;
+    std::uint64_t linkCount;
+    std::uint64_t nameBytes;
+};
+
+struct TopologyDevice
+{
+    std::int32_t  id;
+    DeviceKind    kind;
+    std::uint8_t  scope;      // NetworkScope
+    std::uint16_t nameLength;
+    IpAddress     ip;
+    std::uint32_t nameOffset; // into the name table
+};
+
+struct TopologyLink
+{
+    std::int32_t  a;
+    std::int32_t  b;
+    std::uint32_t bufferBytes; // 0 = the network's default
+    std::uint32_t reserved;
+    double        bandwidthMbps;
+    double        latencyMs;
+};
+
+static_assert(sizeof(TopologyHeader) == 32, "binary topology layout");
+static_assert(sizeof(TopologyDevice) == 16, "binary topology layout");
+static_assert(sizeof(TopologyLink) == 32, "binary topology layout");
+
+// a topology held in memory: what the text reader produces and what both
+// writers take
+struct Topology
+{
+    std::vector<TopologyDevice> devices;
+    std::vector<TopologyLink>   links;
+    std::string                 names;
+
+    std::string name(const TopologyDevice& d) const { return names.substr(d.nameOffset, d.nameLength); }
+};
+
+// A binary topology mapped read-only. The arrays point into the mapping
+// and stay valid until close() or destruction.
+class MappedTopology
+{
+public:
+    MappedTopology() = default;
+    ~MappedTopology() { close(); }
+    MappedTopology(const MappedTopology&) = delete;
+    MappedTopology& operator=(const MappedTopology&) = delete;
+
+    // maps and validates the file; false with a reason in `error`
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const TopologyDevice* devices()     const { return devices_; }
+    std::size_t           deviceCount() const { return deviceCount_; }
+    const TopologyLink*   links()       const { return links_; }
+    std::size_t           linkCount()   const { return linkCount_; }
+    const char*           names()       const { return names_; }
+    std::size_t           nameBytes()   const { return nameBytes_; }
+
+private:
+    void*                 map_  = nullptr;
+    std::size_t           size_ = 0;
+    const TopologyDevice* devices_ = nullptr;
+    std::size_t           deviceCount_ = 0;
+    const TopologyLink*   links_ = nullptr;
+    std::size_t           linkCount_ = 0;
+    const char*           names_ = nullptr;
+    std::size_t           nameBytes_ = 0;
+};
+
+// is `path` a binary topology (by its magic)?
+bool isBinaryTopology(const std::string& path);
+
+// text form; errors are "line N: ..."
+bool readTopologyText(const std::string& path, Topology& out, std::string& error);
+bool writeTopologyText(const std::string& path, const Topology& topo, std::string& error);
+bool writeTopologyBinary(const std::string& path, const Topology& topo, std::string& error);
+
+// either form, by magic; a binary file is copied out of its mapping
+bool readTopology(const std::string& path, Topology& out, std::string& error);
+
+// Add the devices, then the links, to `net`. Capacity is reserved up front
+// so nothing grows on the way. Fails (leaving what was added) if an id is
+// taken or a link names a missing device.
+bool loadTopology(Network& net, const TopologyDevice* devices, std::size_t deviceCount,
+                  const TopologyLink* links, std::size_t linkCount,
+                  const char* names, std::size_t nameBytes, std::string& error);
+bool loadTopology(Network& net, const Topology& topo, std::string& error);
+
+// a file of either form straight into `net`; binary files are mapped
+bool loadTopologyFile(Network& net, const std::string& path, std::string& error);
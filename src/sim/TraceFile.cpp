@@ -0,0 +1,311 @@
+#include "TraceFile.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char          kMagic[8] = { 'N', 'S', 'T', 'R', 'A', 'C', 'E', '\1' };
+static constexpr std::uint32_t kVersion  = 1;
+
+// pages behind the read position are handed back in steps this large
+static constexpr std::size_t kReleaseStep = 64u << 20;
+
+static constexpr std::uint32_t kLinkEthernet  = 1;
+static constexpr std::uint32_t kLinkRaw       = 101;
+static constexpr std::uint32_t kLinkLinuxSll  = 113;
+static constexpr std::uint32_t kLinkIpv4      = 228;
+static constexpr std::uint32_t kLinkIpv6      = 229;
+static constexpr std::uint32_t kLinkLinuxSll2 = 276;
+
+static std::uint16_t be16(const std::uint8_t* p) { return static_cast<std::uint16_t>((p[0] << 8) | p[1]); }
+
+static std::uint32_t swap32(std::uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+}
+
+// ---- reader ----------------------------------------------------------------
+
+bool TraceReader::open(const std::string& path, std::string& error)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open";
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < 24) {
+        ::close(fd);
+        error = "too short for a trace header";
+        return false;
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+    if (map == MAP_FAILED) {
+        size_ = 0;
+        error = "mmap failed";
+        return false;
+    }
+    map_ = map;
+    ::madvise(map_, size_, MADV_SEQUENTIAL);
+
+    const auto* base = static_cast<const std::uint8_t*>(map_);
+    if (std::memcmp(base, kMagic, sizeof kMagic) == 0) {
+        TraceHeader h;
+        std::memcpy(&h, base, sizeof h);
+        if (h.version != kVersion || h.recordSize != sizeof(TraceRecord)) {
+            close();
+            error = "not a version 1 native trace";
+            return false;
+        }
+        if (h.recordCount > (size_ - sizeof h) / sizeof(TraceRecord)) {
+            close();
+            error = "record count runs past the end of the file";
+            return false;
+        }
+        format_ = Format::Native;
+        start_  = sizeof h;
+        end_    = start_ + h.recordCount * sizeof(TraceRecord);
+        truncated_ = end_ != size_; // anything past the counted records is ignored
+    } else {
+        std::uint32_t magic;
+        std::memcpy(&magic, base, 4);
+        swapped_ = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+        if (swapped_) magic = swap32(magic);
+        if (magic != 0xa1b2c3d4 && magic != 0xa1b23c4d) {
+            close();
+            error = "neither a pcap nor a native trace (pcapng is not read)";
+            return false;
+        }
+        tsUnit_ = magic == 0xa1b23c4d ? 1e-9 : 1e-6;
+        std::memcpy(&linkType_, base + 20, 4);
+        if (swapped_) linkType_ = swap32(linkType_);
+        linkType_ &= 0x0FFFFFFF; // upper bits carry FCS flags
+        switch (linkType_) {
+        case kLinkEthernet: case kLinkRaw: case kLinkLinuxSll:
+        case kLinkIpv4: case kLinkIpv6: case kLinkLinuxSll2:
+            break;
+        default:
+            close();
+            error = "unsupported pcap link type " + std::to_string(linkType_);
+            return false;
+        }
+        format_ = Format::Pcap;
+        start_  = 24;
+        end_    = size_;
+    }
+    rewind();
+    return true;
+}
+
+void TraceReader::close()
+{
+    if (map_) ::munmap(map_, size_);
+    map_       = nullptr;
+    size_      = 0;
+    decoded_   = 0;
+    skipped_   = 0;
+    truncated_ = false;
+}
+
+void TraceReader::rewind()
+{
+    pos_      = start_;
+    released_ = 0;
+}
+
+std::size_t TraceReader::read(TraceRecord* out, std::size_t max)
+{
+    if (!map_) return 0;
+    const auto* base = static_cast<const std::uint8_t*>(map_);
+    std::size_t n = 0;
+
+    if (format_ == Format::Native) {
+        n = std::min(max, (end_ - pos_) / sizeof(TraceRecord));
+        std::memcpy(out, base + pos_, n * sizeof(TraceRecord));
+        pos_ += n * sizeof(TraceRecord);
+        decoded_ += n;
+    } else {
+        while (n < max && pos_ < end_) {
+            if (end_ - pos_ < 16) {
+                truncated_ = true;
+                pos_ = end_;
+                break;
+            }
+            std::uint32_t h[4]; // seconds, fraction, captured, on the wire
+            std::memcpy(h, base + pos_, sizeof h);
+            if (swapped_) {
+                for (auto& v : h) v = swap32(v);
+            }
+            if (h[2] > end_ - pos_ - 16) {
+                truncated_ = true;
+                pos_ = end_;
+                break;
+            }
+            const std::uint8_t* frame = base + pos_ + 16;
+            pos_ += 16 + h[2];
+            const double time = static_cast<double>(h[0]) + static_cast<double>(h[1]) * tsUnit_;
+            if (decodePcap(frame, h[2], h[3], time, out[n])) {
+                ++n;
+                ++decoded_;
+            } else {
+                ++skipped_;
+            }
+        }
+    }
+    releaseBehind();
+    return n;
+}
+
+bool TraceReader::decodePcap(const std::uint8_t* p, std::uint32_t len, std::uint32_t wireLength,
+                             double time, TraceRecord& out) const
+{
+    // link layer: find the IP version and where the datagram starts
+    unsigned version = 0;
+    std::uint32_t l2 = 0;
+    std::uint16_t etherType = 0;
+    switch (linkType_) {
+    case kLinkEthernet:
+        if (len < 14) return false;
+        etherType = be16(p + 12);
+        l2 = 14;
+        while ((etherType == 0x8100 || etherType == 0x88A8) && len >= l2 + 4) {
+            etherType = be16(p + l2 + 2);
+            l2 += 4;
+        }
+        break;
+    case kLinkLinuxSll:
+        if (len < 16) return false;
+        etherType = be16(p + 14);
+        l2 = 16;
+        break;
+    case kLinkLinuxSll2:
+        if (len < 20) return false;
+        etherType = be16(p);
+        l2 = 20;
+        break;
+    case kLinkIpv4:
+        version = 4;
+        break;
+    case kLinkIpv6:
+        version = 6;
+        break;
+    default: // raw
+        if (len < 1) return false;
+        version = p[0] >> 4;
+        break;
+    }
+    if (etherType == 0x0800) version = 4;
+    else if (etherType == 0x86DD) version = 6;
+    p += l2;
+    len -= l2;
+    const std::uint32_t wireIp = wireLength > l2 ? wireLength - l2 : 0;
+
+    std::uint8_t proto;
+    std::uint32_t ipHeader;
+    bool firstFragment = true;
+    std::memset(out.src, 0, sizeof out.src);
+    std::memset(out.dst, 0, sizeof out.dst);
+    if (version == 4) {
+        if (len < 20 || (p[0] >> 4) != 4) return false;
+        ipHeader = (p[0] & 0x0F) * 4u;
+        if (ipHeader < 20 || len < ipHeader) return false;
+        const std::uint16_t total = be16(p + 2);
+        out.sizeBytes = total != 0 ? total : wireIp; // 0 under segmentation offload
+        proto = p[9];
+        firstFragment = (be16(p + 6) & 0x1FFF) == 0;
+        std::memcpy(out.src, p + 12, 4);
+        std::memcpy(out.dst, p + 16, 4);
+        out.family = AddressFamily::IPv4;
+    } else if (version == 6) {
+        if (len < 40 || (p[0] >> 4) != 6) return false;
+        const std::uint16_t payload = be16(p + 4);
+        out.sizeBytes = payload != 0 ? payload + 40u : wireIp;
+        proto = p[6];
+        std::memcpy(out.src, p + 8, 16);
+        std::memcpy(out.dst, p + 24, 16);
+        out.family = AddressFamily::IPv6;
+        // step over hop-by-hop, routing, fragment and destination options
+        ipHeader = 40;
+        while ((proto == 0 || proto == 43 || proto == 44 || proto == 60) && len >= ipHeader + 8) {
+            const std::uint8_t* ext = p + ipHeader;
+            if (proto == 44) firstFragment = (be16(ext + 2) & 0xFFF8) == 0;
+            ipHeader += proto == 44 ? 8u : (ext[1] + 1u) * 8u;
+            proto = ext[0];
+        }
+    } else {
+        return false;
+    }
+
+    if (proto == 6) out.transport = TransportProtocol::TCP;
+    else if (proto == 17) out.transport = TransportProtocol::UDP;
+    else return false;
+
+    // later fragments and headers cut off by the snap length have no ports
+    const bool ports = firstFragment && len >= ipHeader + 4;
+    out.srcPort   = ports ? be16(p + ipHeader) : 0;
+    out.dstPort   = ports ? be16(p + ipHeader + 2) : 0;
+    out.time      = time;
+    out.reserved  = 0;
+    out.reserved2 = 0;
+    return true;
+}
+
+void TraceReader::releaseBehind()
+{
+    if (pos_ - released_ < kReleaseStep) return;
+    const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t end = pos_ & ~(page - 1);
+    ::madvise(static_cast<char*>(map_) + released_, end - released_, MADV_DONTNEED);
+    released_ = end;
+}
+
+// ---- writer ----------------------------------------------------------------
+
+bool TraceWriter::open(const std::string& path, std::string& error)
+{
+    std::string ignored;
+    close(ignored);
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        error = "cannot create";
+        return false;
+    }
+    count_ = 0;
+    TraceHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version    = kVersion;
+    h.recordSize = sizeof(TraceRecord);
+    if (std::fwrite(&h, sizeof h, 1, file_) != 1) {
+        error = "write failed";
+        return false;
+    }
+    return true;
+}
+
+bool TraceWriter::write(const TraceRecord* records, std::size_t count, std::string& error)
+{
+    if (!file_ || std::fwrite(records, sizeof(TraceRecord), count, file_) != count) {
+        error = "write failed";
+        return false;
+    }
+    count_ += count;
+    return true;
+}
+
+bool TraceWriter::close(std::string& error)
+{
+    if (!file_) return true;
+    bool ok = std::fseek(file_, static_cast<long>(offsetof(TraceHeader, recordCount)), SEEK_SET) == 0 &&
+              std::fwrite(&count_, sizeof count_, 1, file_) == 1;
+    ok = std::fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    if (!ok) error = "write failed";
+    return ok;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "Device.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Recorded traffic on disk, read through a read-only mapping so a trace
+// far larger than memory streams through a small, fixed working set.
+//
+// Two inputs are accepted:
+//   - classic pcap (microsecond or nanosecond, either byte order) with
+//     Ethernet, Linux cooked or raw IP link types; TCP and UDP over IPv4
+//     or IPv6 are decoded, everything else is skipped and counted
+//   - the native trace (.nstrace): a TraceHeader followed by TraceRecords,
+//     which is what a pcap decodes to, stored so replay copies instead of
+//     parses. 40NetSim-trace converts one to the other.
+
+// one packet as recorded
+struct TraceRecord
+{
+    double            time;      // seconds, as recorded
+    std::uint32_t     sizeBytes; // IP datagram length
+    std::uint16_t     srcPort;
+    std::uint16_t     dstPort;
+    TransportProtocol transport;
+    AddressFamily     family;
+    std::uint16_t     reserved;
+    std::uint32_t     reserved2;
+    std::uint8_t      src[16];   // IPv4 in the first 4 bytes, network order
+    std::uint8_t      dst[16];
+};
+
+struct TraceHeader
+{
+    char          magic[8]; // "NSTRACE\1"
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t recordCount;
+};
+
+static_assert(sizeof(TraceRecord) == 56, "native trace layout");
+static_assert(sizeof(TraceHeader) == 24, "native trace layout");
+
+// IPv4 address of a record side, host order as IpAddress expects
+inline IpAddress traceIpv4(const std::uint8_t* a)
+{
+    return makeIpv4(a[0], a[1], a[2], a[3]);
+}
+
+// Decodes a mapped trace front to back in batches. Pages already read are
+// released as the reader moves on, so resident memory stays bounded.
+class TraceReader
+{
+public:
+    enum class Format
+    {
+        Pcap,
+        Native
+    };
+
+    TraceReader() = default;
+    ~TraceReader() { close(); }
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    // maps the file and checks its header; false with a reason in `error`
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    // decode up to `max` records into `out`; 0 at the end of the trace
+    std::size_t read(TraceRecord* out, std::size_t max);
+    // start again from the first record
+    void rewind();
+
+    Format        format()    const { return format_; }
+    std::uint64_t decoded()   const { return decoded_; }
+    // records that are not TCP or UDP over IP
+    std::uint64_t skipped()   const { return skipped_; }
+    // the file ends inside a record
+    bool          truncated() const { return truncated_; }
+
+private:
+    bool decodePcap(const std::uint8_t* rec, std::uint32_t capLength, std::uint32_t wireLength,
+                    double time, TraceRecord& out) const;
+    void releaseBehind();
+
+    void*         map_   = nullptr;
+    std::size_t   size_  = 0;
+    Format        format_ = Format::Pcap;
+    std::size_t   start_ = 0; // offset of the first record
+    std::size_t   end_   = 0; // and one past the last
+    std::size_t   pos_   = 0;
+    std::size_t   released_ = 0;
+
+    // pcap header fields
+    bool          swapped_  = false;
+    double        tsUnit_   = 1e-6;
+    std::uint32_t linkType_ = 0;
+
+    std::uint64_t decoded_   = 0;
+    std::uint64_t skipped_   = 0;
+    bool          truncated_ = false;
+};
+
+// Writes a native trace: records are appended in order and the header's
+// record count is filled in on close.
+class TraceWriter
+{
+public:
+    TraceWriter() = default;
+    ~TraceWriter() { std::string ignored; close(ignored); }
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    bool write(const TraceRecord* records, std::size_t count, std::string& error);
+    bool close(std::string& error);
+
+private:
+    std::FILE*    file_  = nullptr;
+    std::uint64_t count_ = 0;
+};
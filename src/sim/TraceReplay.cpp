@@ -0,0 +1,120 @@
+#include "TraceReplay.hpp"
+#include "Random.hpp"
+#include <algorithm>
+#include <cstring>
+
+static constexpr std::size_t kBatch       = 4096; // records decoded per refill
+static constexpr double      kWindow      = 0.1;  // simulated seconds scheduled per fire
+static constexpr std::size_t kMaxPerFire  = 4096; // records per fire, whatever the window
+
+void TraceReplay::start(const std::vector<int>& devices, const Options& options)
+{
+    options_ = options;
+    if (options_.speed <= 0.0) options_.speed = 1.0;
+    byAddress_.clear();
+    devices_.clear();
+    for (int id : devices) {
+        const Device* dev = network_.getDevice(id);
+        if (!dev) continue;
+        devices_.push_back(id);
+        if (IpAddress ip = dev->ip()) byAddress_.emplace(ip, id);
+    }
+
+    batch_.resize(kBatch);
+    batchPos_ = batchEnd_ = 0;
+    done_ = devices_.empty() || !refill();
+    if (done_) return;
+    origin_ = batch_[0].time;
+    start_  = sim_.time();
+    sim_.scheduleTimer(start_, [this](double t) { fire(t); });
+}
+
+bool TraceReplay::refill()
+{
+    batchEnd_ = reader_.read(batch_.data(), batch_.size());
+    batchPos_ = 0;
+    return batchEnd_ > 0;
+}
+
+void TraceReplay::fire(double now)
+{
+    const double until = now + kWindow;
+    std::size_t count = 0;
+    for (;;) {
+        if (batchPos_ == batchEnd_ && !refill()) {
+            done_ = true;
+            return;
+        }
+        // captures are not always in order; late records go out now
+        const double at = std::max(timeOf(batch_[batchPos_]), now);
+        if (at >= until || count == kMaxPerFire) {
+            sim_.scheduleTimer(at, [this](double t) { fire(t); });
+            return;
+        }
+        inject(batch_[batchPos_++], at);
+        ++count;
+    }
+}
+
+int TraceReplay::deviceFor(const std::uint8_t* addr, AddressFamily family) const
+{
+    std::uint64_t key;
+    if (family == AddressFamily::IPv4) {
+        const IpAddress ip = traceIpv4(addr);
+        auto it = byAddress_.find(ip);
+        if (it != byAddress_.end()) return it->second;
+        key = ip;
+    } else {
+        std::uint64_t hi, lo;
+        std::memcpy(&hi, addr, 8);
+        std::memcpy(&lo, addr + 8, 8);
+        key = hi ^ CounterRng::mix(lo);
+    }
+    if (!options_.hashUnknown) return -1;
+    return devices_[CounterRng::mix(key) % devices_.size()];
+}
+
+void TraceReplay::inject(const TraceRecord& r, double at)
+{
+    const int src = deviceFor(r.src, r.family);
+    const int dst = deviceFor(r.dst, r.family);
+    if (src < 0 || dst < 0) {
+        ++unmapped_;
+        return;
+    }
+    const int lid  = network_.nextLink(src, dst);
+    const Link* link = network_.getLink(lid);
+    if (!link) {
+        ++unroutable_;
+        return;
+    }
+
+    Packet p;
+    p.id        = nextPacketId_++;
+    p.srcNodeId = src;
+    p.dstNodeId = dst;
+    p.sizeBytes = std::max<std::uint32_t>(r.sizeBytes, 1);
+    p.createdAt = at;
+    p.srcPort   = r.srcPort;
+    p.dstPort   = r.dstPort;
+    p.transport = r.transport;
+    p.family    = r.family;
+    if (r.family == AddressFamily::IPv4) {
+        p.srcIp = traceIpv4(r.src);
+        p.dstIp = traceIpv4(r.dst);
+    } else {
+        Ipv6Address a;
+        std::memcpy(a.data(), r.src, 16);
+        p.srcIp = ipv6Table().intern(a);
+        std::memcpy(a.data(), r.dst, 16);
+        p.dstIp = ipv6Table().intern(a);
+    }
+    const std::uint16_t server = std::min(r.srcPort, r.dstPort);
+    p.app = server == 443 ? ApplicationProtocol::HTTPS
+          : server == 80  ? ApplicationProtocol::HTTP
+          : server == 53  ? ApplicationProtocol::DNS
+                          : ApplicationProtocol::OTHER;
+
+    sim_.schedulePacket(p, src, link->nodeA == src ? link->nodeB : link->nodeA, at, lid);
+    ++injected_;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Network.hpp"
+#include "Simulation.hpp"
+#include "TraceFile.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Replays a recorded trace as simulation traffic. A record's addresses are
+// mapped to devices: an address one of the replay's devices owns maps to
+// that device, any other is hashed onto the replay's devices so a capture
+// from elsewhere still loads the network (or, with hashUnknown off, the
+// record is counted as unmapped and skipped). Each packet enters at its
+// source device, on the first hop toward its destination, at
+//
+//   start + (recorded time - first recorded time) / speed
+//
+// so speed 10 plays a trace ten times faster in simulated time. Wall-clock
+// pace is up to whoever runs the simulation; headless runs as fast as it
+// can. As in TrafficGenerator, a timer fires at the next record, decodes
+// and schedules a window's worth in one batch and re-arms, so only a batch
+// of the trace is ever in memory.
+//
+// IPv6 addresses are interned into ipv6Table() as records are decoded, so
+// nothing else may read the table concurrently while an IPv6 trace plays.
+class TraceReplay
+{
+public:
+    struct Options
+    {
+        double speed       = 1.0;
+        bool   hashUnknown = true;
+    };
+
+    // packet ids are taken from `nextPacketId`, shared with the owner; the
+    // reader must stay open while the replay runs
+    TraceReplay(Network& net, Simulation& sim, TraceReader& reader, std::uint64_t& nextPacketId)
+        : network_(net), sim_(sim), reader_(reader), nextPacketId_(nextPacketId) {}
+
+    TraceReplay(const TraceReplay&) = delete;
+    TraceReplay& operator=(const TraceReplay&) = delete;
+
+    // map addresses onto `devices` and start at the current simulation time
+    void start(const std::vector<int>& devices, const Options& options);
+
+    bool          done()       const { return done_; }
+    std::uint64_t injected()   const { return injected_; }
+    std::uint64_t unmapped()   const { return unmapped_; }
+    // no path between the mapped devices, or both ends on one device
+    std::uint64_t unroutable() const { return unroutable_; }
+
+private:
+    void   fire(double now);
+    bool   refill();
+    double timeOf(const TraceRecord& r) const { return start_ + (r.time - origin_) / options_.speed; }
+    int    deviceFor(const std::uint8_t* addr, AddressFamily family) const;
+    void   inject(const TraceRecord& r, double at);
+
+    Network&       network_;
+    Simulation&    sim_;
+    TraceReader&   reader_;
+    std::uint64_t& nextPacketId_;
+    Options        options_;
+
+    std::unordered_map<IpAddress, int> byAddress_;
+    std::vector<int>                   devices_;
+
+    std::vector<TraceRecord> batch_;
+    std::size_t              batchPos_ = 0;
+    std::size_t              batchEnd_ = 0;
+
+    double origin_ = 0.0; // first recorded time
+    double start_  = 0.0; // simulated time it plays at
+    bool   done_   = false;
+
+    std::uint64_t injected_   = 0;
+    std::uint64_t unmapped_   = 0;
+    std::uint64_t unroutable_ = 0;
+};
@@ -0,0 +1,486 @@
+#include "TrafficGenerator.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <istream>
+#include <sstream>
+
+static constexpr std::size_t kDrawBatch   = 256;  // draws sampled per refill
+static constexpr double      kWindow      = 1.0;  // seconds of arrivals scheduled per fire
+static constexpr std::size_t kMaxPerFire  = 4096; // arrivals per fire, whatever the window
+
+// ---- parsing ---------------------------------------------------------------
+
+static std::string trim(const std::string& s)
+{
+    std::size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return std::string();
+    std::size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+static bool toNumber(const std::string& s, double& out)
+{
+    char* end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return !s.empty() && end && *end == '\0';
+}
+
+static bool parseArrival(std::istringstream& args, TrafficProfile& p, std::string& why)
+{
+    std::string kind;
+    args >> kind;
+    std::vector<std::string> rest;
+    for (std::string w; args >> w;) rest.push_back(w);
+    if (!rest.empty() && rest.back() == "per-client") {
+        p.perClient = true;
+        rest.pop_back();
+    }
+
+    std::vector<double> v(rest.size());
+    for (std::size_t i = 0; i < rest.size(); ++i) {
+        if (!toNumber(rest[i], v[i]) || v[i] <= 0.0) {
+            why = "expected a positive number, got '" + rest[i] + "'";
+            return false;
+        }
+    }
+    if (kind == "periodic" && v.size() == 1) {
+        p.arrival = TrafficProfile::Arrival::Periodic;
+        p.period  = v[0];
+    } else if (kind == "poisson" && v.size() == 1) {
+        p.arrival = TrafficProfile::Arrival::Poisson;
+        p.rate    = v[0];
+    } else if (kind == "onoff" && v.size() == 3) {
+        p.arrival = TrafficProfile::Arrival::OnOff;
+        p.rate    = v[0];
+        p.meanOn  = v[1];
+        p.meanOff = v[2];
+    } else {
+        why = "arrival is periodic <s>, poisson <rate> or onoff <rate> <on> <off>";
+        return false;
+    }
+    return true;
+}
+
+static bool parseSize(std::istringstream& args, TrafficProfile& p, std::string& why)
+{
+    std::string kind, a, b, extra;
+    args >> kind >> a >> b >> extra;
+    double x = 0.0, y = 0.0;
+    if (kind == "fixed" && b.empty() && toNumber(a, x) && x >= 1.0) {
+        p.size  = TrafficProfile::Size::Fixed;
+        p.sizeA = x;
+    } else if (kind == "uniform" && extra.empty() && toNumber(a, x) && toNumber(b, y) &&
+               x >= 1.0 && y >= x) {
+        p.size  = TrafficProfile::Size::Uniform;
+        p.sizeA = x;
+        p.sizeB = y;
+    } else if (kind == "exponential" && b.empty() && toNumber(a, x) && x >= 1.0) {
+        p.size  = TrafficProfile::Size::Exponential;
+        p.sizeA = x;
+    } else {
+        why = "size is fixed <bytes>, uniform <lo> <hi> or exponential <mean>";
+        return false;
+    }
+    return true;
+}
+
+static bool parsePort(const std::string& s, std::uint16_t& port)
+{
+    double v = 0.0;
+    if (!toNumber(s, v) || v < 0.0 || v > 65535.0 || v != static_cast<int>(v)) return false;
+    port = static_cast<std::uint16_t>(v);
+    return true;
+}
+
+static bool parsePacket(std::istringstream& args, TrafficProfile& p, std::string& why)
+{
+    std::string transport, app, port, extra;
+    args >> transport >> app >> port >> extra;
+    if      (transport == "tcp") p.transport = TransportProtocol::TCP;
+    else if (transport == "udp") p.transport = TransportProtocol::UDP;
+    else { why = "transport is tcp or udp"; return false; }
+
+    if      (app == "https") p.app = ApplicationProtocol::HTTPS;
+    else if (app == "http")  p.app = ApplicationProtocol::HTTP;
+    else if (app == "dns")   p.app = ApplicationProtocol::DNS;
+    else if (app == "other") p.app = ApplicationProtocol::OTHER;
+    else { why = "application is https, http, dns or other"; return false; }
+
+    if (!parsePort(port, p.dstPort) || !extra.empty()) {
+        why = "packet is <tcp|udp> <https|http|dns|other> <dst port>";
+        return false;
+    }
+    return true;
+}
+
+static bool parseSrcPort(std::istringstream& args, TrafficProfile& p, std::string& why)
+{
+    std::string base, mode, extra;
+    args >> base >> mode >> extra;
+    if (!parsePort(base, p.srcPort) || !extra.empty()) {
+        why = "srcport is <base> [+client|+burst]";
+        return false;
+    }
+    if      (mode.empty())      p.srcPortMode = TrafficProfile::SrcPort::Fixed;
+    else if (mode == "+client") p.srcPortMode = TrafficProfile::SrcPort::PlusClient;
+    else if (mode == "+burst")  p.srcPortMode = TrafficProfile::SrcPort::PlusBurst;
+    else { why = "srcport is <base> [+client|+burst]"; return false; }
+    return true;
+}
+
+bool parseTrafficProfiles(std::istream& in, std::vector<TrafficProfile>& out, std::string& error)
+{
+    std::vector<TrafficProfile> parsed;
+    bool inBlock = false;
+    int lineNo = 0;
+    std::string line;
+    auto fail = [&](const std::string& why) {
+        error = "line " + std::to_string(lineNo) + ": " + why;
+        return false;
+    };
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        std::istringstream args(line);
+        std::string key;
+        args >> key;
+
+        if (key == "profile") {
+            if (inBlock) return fail("'profile' inside a profile; missing 'end'?");
+            std::string name, extra;
+            args >> name >> extra;
+            if (name.empty() || !extra.empty()) return fail("expected 'profile <name>'");
+            parsed.emplace_back();
+            parsed.back().name = name;
+            inBlock = true;
+            continue;
+        }
+        if (!inBlock) return fail("'" + key + "' outside a profile block");
+        TrafficProfile& p = parsed.back();
+
+        std::string why;
+        if (key == "end") {
+            inBlock = false;
+        } else if (key == "clients") {
+            // comma separated, since device types contain spaces
+            std::string list = trim(line.substr(key.size()));
+            p.clientTypes.clear();
+            if (list != "*") {
+                std::istringstream items(list);
+                for (std::string item; std::getline(items, item, ',');) {
+                    item = trim(item);
+                    if (item.empty()) return fail("empty client type");
+                    p.clientTypes.push_back(item);
+                }
+            }
+        } else if (key == "arrival") {
+            if (!parseArrival(args, p, why)) return fail(why);
+        } else if (key == "size") {
+            if (!parseSize(args, p, why)) return fail(why);
+        } else if (key == "packet") {
+            if (!parsePacket(args, p, why)) return fail(why);
+        } else if (key == "srcport") {
+            if (!parseSrcPort(args, p, why)) return fail(why);
+        } else if (key == "burst") {
+            double n = 0.0;
+            std::string s, extra;
+            args >> s >> extra;
+            if (!toNumber(s, n) || n < 1.0 || n != static_cast<int>(n) || !extra.empty()) {
+                return fail("burst is a whole number of packets, at least 1");
+            }
+            p.burst = static_cast<int>(n);
+        } else {
+            return fail("unknown key '" + key + "'");
+        }
+    }
+    if (inBlock) return fail("profile '" + parsed.back().name + "' has no 'end'");
+
+    out.insert(out.end(), parsed.begin(), parsed.end());
+    return true;
+}
+
+// ---- generation ------------------------------------------------------------
+
+TrafficGenerator::TrafficGenerator(Network& net, Simulation& sim, std::uint64_t seed,
+                                   std::uint64_t& nextPacketId)
+    : network_(net), sim_(sim), seed_(seed), nextPacketId_(nextPacketId)
+{
+}
+
+void TrafficGenerator::start(const std::vector<int>& devices)
+{
+    const double now = sim_.time();
+    const std::size_t first = streams_.size();
+    for (std::size_t pi = 0; pi < profiles_.size(); ++pi) {
+        const TrafficProfile& prof = profiles_[pi];
+        Stream st;
+        st.profile = pi;
+
+        for (int id : devices) {
+            const Device* dev = network_.getDevice(id);
+            if (!dev) continue;
+            if (!prof.clientTypes.empty()) {
+                const std::string type = dev->info().type;
+                if (std::find(prof.clientTypes.begin(), prof.clientTypes.end(), type) ==
+                    prof.clientTypes.end()) {
+                    continue;
+                }
+            }
+            const std::vector<int>& links = network_.linksOf(id);
+            const Link* link = links.empty() ? nullptr : network_.getLink(links.front());
+            if (!link) continue;
+            int gateway = link->nodeA == id ? link->nodeB : link->nodeA;
+            const Device* gw = network_.getDevice(gateway); // null if remote
+            st.clients.push_back(Client{ id, gateway, dev->ip(), gw ? gw->ip() : 0 });
+        }
+        if (st.clients.empty()) continue;
+        st.rng = streamRng(st);
+
+        if (prof.arrival == TrafficProfile::Arrival::OnOff) {
+            st.on       = true;
+            st.phaseEnd = now + prof.meanOn * exponential(st);
+        }
+        // periodic streams fire straight away, random ones after a first gap
+        st.next = prof.arrival == TrafficProfile::Arrival::Periodic ? now : nextArrival(st, now);
+        streams_.push_back(std::move(st));
+    }
+
+    for (std::size_t s = first; s < streams_.size(); ++s) {
+        streams_[s].timer = sim_.scheduleTimer(streams_[s].next, [this, s](double t) { fire(s, t); });
+    }
+}
+
+double TrafficGenerator::exponential(Stream& st)
+{
+    if (st.gapPos == st.gaps.size()) {
+        st.gaps.resize(kDrawBatch);
+        st.rng.fillExponential(st.gaps.data(), kDrawBatch, 1.0);
+        st.gapPos = 0;
+    }
+    return st.gaps[st.gapPos++];
+}
+
+double TrafficGenerator::uniform(Stream& st)
+{
+    if (st.uniformPos == st.uniforms.size()) {
+        st.uniforms.resize(kDrawBatch);
+        st.rng.fillUniform(st.uniforms.data(), kDrawBatch);
+        st.uniformPos = 0;
+    }
+    return st.uniforms[st.uniformPos++];
+}
+
+double TrafficGenerator::nextArrival(Stream& st, double t)
+{
+    const TrafficProfile& prof = profiles_[st.profile];
+    const double clients = prof.perClient ? static_cast<double>(st.clients.size()) : 1.0;
+
+    switch (prof.arrival) {
+    case TrafficProfile::Arrival::Periodic:
+        return t + prof.period / clients;
+    case TrafficProfile::Arrival::Poisson:
+        return t + exponential(st) / (prof.rate * clients);
+    case TrafficProfile::Arrival::OnOff:
+        // exponential gaps are memoryless, so a gap cut short by the end of
+        // an on phase simply restarts when the next one begins
+        for (;;) {
+            if (st.on) {
+                double at = t + exponential(st) / (prof.rate * clients);
+                if (at < st.phaseEnd) return at;
+                t = st.phaseEnd;
+                st.on = false;
+                st.phaseEnd = t + prof.meanOff * exponential(st);
+            } else {
+                t = st.phaseEnd;
+                st.on = true;
+                st.phaseEnd = t + prof.meanOn * exponential(st);
+            }
+        }
+    }
+    return t;
+}
+
+std::uint32_t TrafficGenerator::sampleSize(Stream& st)
+{
+    const TrafficProfile& prof = profiles_[st.profile];
+    double bytes = prof.sizeA;
+    if (prof.size == TrafficProfile::Size::Uniform) {
+        bytes = prof.sizeA + std::min(uniform(st) * (prof.sizeB - prof.sizeA + 1.0),
+                                      prof.sizeB - prof.sizeA);
+    } else if (prof.size == TrafficProfile::Size::Exponential) {
+        bytes = prof.sizeA * exponential(st);
+    }
+    return static_cast<std::uint32_t>(std::max(1.0, std::min(bytes, 4294967295.0)));
+}
+
+void TrafficGenerator::emit(Stream& st, double at)
+{
+    const TrafficProfile& prof = profiles_[st.profile];
+    const std::size_t n = st.clients.size();
+
+    std::size_t ci = 0;
+    if (prof.arrival == TrafficProfile::Arrival::Periodic && prof.perClient) {
+        ci = st.roundRobin++ % n; // spread evenly, each client once per period
+    } else if (n > 1) {
+        ci = std::min(n - 1, static_cast<std::size_t>(uniform(st) * static_cast<double>(n)));
+    }
+    const Client& c = st.clients[ci];
+
+    for (int b = 0; b < prof.burst; ++b) {
+        Packet p;
+        p.id        = nextPacketId_++;
+        p.srcNodeId = c.id;
+        p.dstNodeId = c.gateway;
+        p.sizeBytes = sampleSize(st);
+        p.createdAt = at;
+        p.srcIp     = c.srcIp;
+        p.dstIp     = c.dstIp;
+        p.srcPort   = prof.srcPort;
+        if (prof.srcPortMode == TrafficProfile::SrcPort::PlusClient) {
+            p.srcPort = static_cast<std::uint16_t>(prof.srcPort + ci);
+        } else if (prof.srcPortMode == TrafficProfile::SrcPort::PlusBurst) {
+            p.srcPort = static_cast<std::uint16_t>(prof.srcPort + b);
+        }
+        p.dstPort   = prof.dstPort;
+        p.transport = prof.transport;
+        p.app       = prof.app;
+        sim_.schedulePacket(p, c.id, c.gateway, at);
+    }
+    ++arrivals_;
+}
+
+void TrafficGenerator::fire(std::size_t s, double now)
+{
+    Stream& st = streams_[s];
+    const double until = now + kWindow;
+    std::size_t count = 0;
+    do {
+        emit(st, std::max(st.next, now));
+        st.next = nextArrival(st, st.next);
+    } while (st.next < until && ++count < kMaxPerFire);
+
+    st.timer = sim_.scheduleTimer(st.next, [this, s](double t) { fire(s, t); });
+}
+
+CounterRng TrafficGenerator::streamRng(const Stream& st) const
+{
+    // keyed by the stream's first client, so it does not depend on which
+    // generator, region or thread runs it
+    return CounterRng(seed_, static_cast<std::uint64_t>(st.clients.front().id), st.profile);
+}
+
+void TrafficGenerator::reseed(std::uint64_t seed)
+{
+    seed_ = seed;
+    for (std::size_t s = 0; s < streams_.size(); ++s) {
+        Stream& st = streams_[s];
+        st.rng = streamRng(st);
+        st.gaps.clear();
+        st.uniforms.clear();
+        st.gapPos = st.uniformPos = 0;
+    }
+}
+
+void TrafficGenerator::save(SnapshotWriter& out) const
+{
+    out.put(seed_);
+    out.put(arrivals_);
+    out.put<std::uint64_t>(profiles_.size());
+    for (const TrafficProfile& p : profiles_) {
+        out.putString(p.name);
+        out.put<std::uint64_t>(p.clientTypes.size());
+        for (const std::string& type : p.clientTypes) out.putString(type);
+        out.put(p.arrival);
+        out.put(p.period);
+        out.put(p.rate);
+        out.put(p.meanOn);
+        out.put(p.meanOff);
+        out.put(p.perClient);
+        out.put(p.burst);
+        out.put(p.size);
+        out.put(p.sizeA);
+        out.put(p.sizeB);
+        out.put(p.transport);
+        out.put(p.app);
+        out.put(p.dstPort);
+        out.put(p.srcPort);
+        out.put(p.srcPortMode);
+    }
+    out.put<std::uint64_t>(streams_.size());
+    for (const Stream& st : streams_) {
+        out.put<std::uint64_t>(st.profile);
+        out.putVector(st.clients);
+        out.put(st.rng);
+        out.put(st.next);
+        out.put(st.on);
+        out.put(st.phaseEnd);
+        out.put<std::uint64_t>(st.roundRobin);
+        out.putVector(st.gaps);
+        out.putVector(st.uniforms);
+        out.put<std::uint64_t>(st.gapPos);
+        out.put<std::uint64_t>(st.uniformPos);
+        out.put(st.timer);
+    }
+}
+
+void TrafficGenerator::restore(SnapshotReader& in)
+{
+    if (!streams_.empty()) {
+        in.fail();
+        return;
+    }
+    in.get(seed_);
+    in.get(arrivals_);
+    profiles_.clear();
+    const std::size_t profiles = in.getCount(sizeof(std::uint64_t));
+    for (std::size_t i = 0; i < profiles && in.ok(); ++i) {
+        TrafficProfile p;
+        p.name = in.getString();
+        const std::size_t types = in.getCount(sizeof(std::uint64_t));
+        for (std::size_t k = 0; k < types && in.ok(); ++k) p.clientTypes.push_back(in.getString());
+        in.get(p.arrival);
+        in.get(p.period);
+        in.get(p.rate);
+        in.get(p.meanOn);
+        in.get(p.meanOff);
+        in.get(p.perClient);
+        in.get(p.burst);
+        in.get(p.size);
+        in.get(p.sizeA);
+        in.get(p.sizeB);
+        in.get(p.transport);
+        in.get(p.app);
+        in.get(p.dstPort);
+        in.get(p.srcPort);
+        in.get(p.srcPortMode);
+        profiles_.push_back(std::move(p));
+    }
+    const std::size_t streams = in.getCount(sizeof(std::uint64_t));
+    for (std::size_t i = 0; i < streams && in.ok(); ++i) {
+        Stream st;
+        st.profile = static_cast<std::size_t>(in.get<std::uint64_t>());
+        in.getVector(st.clients);
+        in.get(st.rng);
+        in.get(st.next);
+        in.get(st.on);
+        in.get(st.phaseEnd);
+        st.roundRobin = static_cast<std::size_t>(in.get<std::uint64_t>());
+        in.getVector(st.gaps);
+        in.getVector(st.uniforms);
+        st.gapPos     = static_cast<std::size_t>(in.get<std::uint64_t>());
+        st.uniformPos = static_cast<std::size_t>(in.get<std::uint64_t>());
+        in.get(st.timer);
+        if (st.profile >= profiles_.size() || st.gapPos > st.gaps.size() ||
+            st.uniformPos > st.uniforms.size()) {
+            in.fail();
+        }
+        streams_.push_back(std::move(st));
+    }
+    for (std::size_t s = 0; s < streams_.size() && in.ok(); ++s) {
+        if (!sim_.bindTimer(streams_[s].timer, [this, s](double t) { fire(s, t); })) in.fail();
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "Network.hpp"
+#include "Random.hpp"
+#include "Simulation.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// One kind of traffic: which devices send it, when, and what it looks like.
+//
+// Profiles are read from a text file, one block per profile:
+//
+//   # comment
+//   profile web
+//       clients  Desktop PC, Laptop, Smartphone   # DeviceInfo::type, or *
+//       arrival  periodic 5                       # seconds between arrivals
+//       burst    5                                # packets per arrival
+//       size     fixed 900
+//       packet   tcp https 443                    # transport, app, dst port
+//       srcport  50000 +burst                     # or +client, or just a base
+//   end
+//
+// arrival is "periodic <seconds>", "poisson <per second>" or
+// "onoff <per second> <mean on s> <mean off s>" (Poisson while on), with an
+// optional trailing "per-client" that scales the rate by the client count.
+// size is "fixed <bytes>", "uniform <lo> <hi>" or "exponential <mean>".
+// Packets go to the client's gateway, the node across its first link.
+struct TrafficProfile
+{
+    enum class Arrival { Periodic, Poisson, OnOff };
+    enum class Size    { Fixed, Uniform, Exponential };
+    enum class SrcPort { Fixed, PlusClient, PlusBurst };
+
+    std::string              name;
+    std::vector<std::string> clientTypes; // empty = every device with a link
+
+    Arrival arrival   = Arrival::Periodic;
+    double  period    = 1.0; // Periodic: seconds between arrivals
+    double  rate      = 1.0; // Poisson, OnOff: arrivals per second
+    double  meanOn    = 1.0; // OnOff
+    double  meanOff   = 1.0;
+    bool    perClient = false;
+    int     burst     = 1;
+
+    Size   size    = Size::Fixed;
+    double sizeA   = 100.0; // Fixed: bytes; Uniform: lo; Exponential: mean
+    double sizeB   = 100.0; // Uniform: hi
+
+    TransportProtocol   transport = TransportProtocol::TCP;
+    ApplicationProtocol app       = ApplicationProtocol::OTHER;
+    std::uint16_t       dstPort   = 0;
+    std::uint16_t       srcPort   = 0;
+    SrcPort             srcPortMode = SrcPort::Fixed;
+};
+
+// Parse profile blocks from `in` and append them to `out`. On a malformed
+// line, returns false with "line N: ..." in `error`.
+bool parseTrafficProfiles(std::istream& in, std::vector<TrafficProfile>& out, std::string& error);
+
+// Runs a set of profiles against a network. Each profile is one stream: a
+// timer fires at its next arrival, samples the arrivals due over the next
+// window in one batch, hands them to the simulation as scheduled packets,
+// and re-arms at the first arrival it did not schedule. Nothing polls per
+// frame, and the cost per arrival does not grow with the client count.
+class TrafficGenerator
+{
+public:
+    // packet ids are taken from `nextPacketId`, shared with the owner
+    TrafficGenerator(Network& net, Simulation& sim, std::uint64_t seed,
+                     std::uint64_t& nextPacketId);
+
+    TrafficGenerator(const TrafficGenerator&) = delete;
+    TrafficGenerator& operator=(const TrafficGenerator&) = delete;
+
+    // profiles take effect at the next start()
+    void addProfile(const TrafficProfile& profile) { profiles_.push_back(profile); }
+    void clearProfiles() { profiles_.clear(); }
+    const std::vector<TrafficProfile>& profiles() const { return profiles_; }
+
+    // bind every profile to the matching devices among `devices` and start
+    // its stream at the current simulation time
+    void start(const std::vector<int>& devices);
+
+    std::uint64_t arrivals() const { return arrivals_; }
+
+    // new random draws from here on, e.g. for what-if runs forked from one
+    // warmed-up state; arrivals already scheduled stand
+    void reseed(std::uint64_t seed);
+
+    // profiles and streams; restore() re-binds each stream's pending timer
+    // in a simulation restored from the same snapshot, and expects a
+    // generator that has not been started
+    void save(SnapshotWriter& out) const;
+    void restore(SnapshotReader& in);
+
+private:
+    struct Client
+    {
+        int       id;
+        int       gateway;
+        IpAddress srcIp;
+        IpAddress dstIp;
+    };
+
+    struct Stream
+    {
+        std::size_t           profile; // index into profiles_
+        std::vector<Client>   clients;
+        CounterRng            rng;
+        double                next = 0.0;  // first arrival not yet scheduled
+        bool                  on   = true; // OnOff
+        double                phaseEnd = 0.0;
+        std::size_t           roundRobin = 0;
+        Simulation::TimerId   timer = 0; // the pending fire
+
+        // batch-sampled draws, consumed from the front
+        std::vector<double> gaps, uniforms;
+        std::size_t         gapPos = 0, uniformPos = 0;
+    };
+
+    CounterRng streamRng(const Stream& st) const;
+    void   fire(std::size_t s, double now);
+    // time of the arrival after one at `t`, stepping through on/off phases
+    double nextArrival(Stream& st, double t);
+    // next unit-rate exponential and (0, 1] uniform draw, refilled in batches
+    double exponential(Stream& st);
+    double uniform(Stream& st);
+    std::uint32_t sampleSize(Stream& st);
+    void   emit(Stream& st, double at);
+
+    Network&        network_;
+    Simulation&     sim_;
+    std::uint64_t   seed_;
+    std::uint64_t&  nextPacketId_;
+    std::uint64_t   arrivals_ = 0;
+
+    std::vector<TrafficProfile> profiles_;
+    std::vector<Stream>         streams_;
+};
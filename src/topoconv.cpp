@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "sim/Network.hpp"
+#include "sim/TopologyFile.hpp"
+
+// Converts a topology between the text and binary forms, or checks that it
+// loads. Usage: 40NetSim-topo <in> <out>   (.topob out = binary, else text)
+//               40NetSim-topo --check <in>
+
+static void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " <in> <out>\n"
+              << "       " << argv0 << " --check <in>\n"
+              << "  either input form is accepted; an output ending in .topob is\n"
+              << "  written binary, anything else as text\n";
+}
+
+static bool endsWith(const std::string& s, const char* suffix)
+{
+    const std::size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    auto seconds = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    if (std::strcmp(argv[1], "--check") == 0) {
+        Network net;
+        if (!loadTopologyFile(net, argv[2], error)) {
+            std::cerr << argv[2] << ": " << error << "\n";
+            return 1;
+        }
+        std::cout << net.devices().size() << " devices, " << net.links().size()
+                  << " links loaded in " << seconds() << " s\n";
+        return 0;
+    }
+
+    const std::string in = argv[1], out = argv[2];
+    Topology topo;
+    if (!readTopology(in, topo, error)) {
+        std::cerr << in << ": " << error << "\n";
+        return 1;
+    }
+    const double readTime = seconds();
+    bool ok = endsWith(out, ".topob") ? writeTopologyBinary(out, topo, error)
+                                      : writeTopologyText(out, topo, error);
+    if (!ok) {
+        std::cerr << out << ": " << error << "\n";
+        return 1;
+    }
+    std::cout << topo.devices.size() << " devices, " << topo.links.size() << " links; read "
+              << readTime << " s, wrote " << seconds() - readTime << " s\n";
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "sim/TraceFile.hpp"
+
+// Converts a pcap into the native trace format, which replays without
+// decoding, or reports what a trace holds. Usage:
+//   40NetSim-trace <in> <out.nstrace>
+//   40NetSim-trace --info <in>
+
+static void usage(const char* argv0)
+{
+    std::cerr << "usage: " << argv0 << " <in> <out.nstrace>\n"
+              << "       " << argv0 << " --info <in>\n"
+              << "  input is a pcap or a native trace; TCP and UDP over IP are kept\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    const bool info = std::strcmp(argv[1], "--info") == 0;
+    const char* inPath  = info ? argv[2] : argv[1];
+    const char* outPath = argv[2];
+    std::string error;
+
+    TraceReader reader;
+    if (!reader.open(inPath, error)) {
+        std::cerr << inPath << ": " << error << "\n";
+        return 1;
+    }
+    TraceWriter writer;
+    if (!info && !writer.open(outPath, error)) {
+        std::cerr << outPath << ": " << error << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<TraceRecord> batch(4096);
+    double first = 0.0, last = 0.0;
+    std::uint64_t bytes = 0;
+    while (std::size_t n = reader.read(batch.data(), batch.size())) {
+        if (reader.decoded() == n) first = batch[0].time;
+        last = batch[n - 1].time;
+        for (std::size_t i = 0; i < n; ++i) bytes += batch[i].sizeBytes;
+        if (!info && !writer.write(batch.data(), n, error)) {
+            std::cerr << outPath << ": " << error << "\n";
+            return 1;
+        }
+    }
+    if (!info && !writer.close(error)) {
+        std::cerr << outPath << ": " << error << "\n";
+        return 1;
+    }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << reader.decoded() << " records, " << reader.skipped() << " skipped, "
+              << bytes << " bytes over " << last - first << " s"
+              << (reader.truncated() ? " (file is truncated)" : "") << "\n"
+              << "read in " << wall << " s ("
+              << (wall > 0.0 ? static_cast<double>(reader.decoded()) / wall : 0.0) << " records/s)\n";
+    return 0;
+}